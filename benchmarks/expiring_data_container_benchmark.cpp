@@ -0,0 +1,410 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "expiration_scheduler.hpp"
+#include "expiring_bloom_filter.hpp"
+#include "expiring_data_container.hpp"
+#include "expiring_data_map.hpp"
+#include "manual_clock.hpp"
+#include "mapped_file_resource.hpp"
+#include "sharded_expiring_data_container.hpp"
+
+/*
+ * Measures the container as it stands, so that every later change can be compared against these numbers:
+ *   insert throughput        per thread count, per item and batched
+ *   instrumentation cost     insert throughput with ContainerStats counting and timing every lock
+ *   compile time TTL         single threaded inserts into StaticExpiringDataContainer against UnsynchronizedPolicy
+ *   query latency            get_valid_data, get_data_exceeding and count_between against the number of stored elements
+ *   expiry after a stall     removing a large expired front in one go
+ *   warm restarts            writing a snapshot of the window to a buffer and restoring a container from it
+ *   handoff                  swap_out of the whole window into a reused buffer, against the number of elements
+ *   cleanup lag              how long expired elements outlive their expiration
+ *   memory per element       bytes allocated through the container's allocator divided by its size
+ *   spilled inserts          insert throughput with the segments in memory mapped files
+ *   mixed readers/writers    inserts and reads per second with half the threads on either side
+ *   keyed lookups            ExpiringDataMap find and insert_or_refresh against the number of stored keys
+ *   deduplication            testing and inserting fresh IDs, with a Bloom filter and against the exact window
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// short enough for steady state inserts to stay in memory, long enough for the window to hold millions
+constexpr auto steady_ttl = std::chrono::milliseconds(50);
+// longer than any benchmark runs, nothing expires
+constexpr auto long_ttl = std::chrono::hours(1);
+
+struct Payload {
+    std::array<std::uint64_t, 8> words{};
+
+    Payload() = default;
+    explicit Payload(std::uint64_t value) { words.fill(value); }
+};
+
+std::atomic<std::int64_t> allocated_bytes{0};
+
+/**
+ * @brief Forwards to std::allocator and keeps track of how many bytes are currently allocated.
+ */
+template <typename T> class CountingAllocator {
+  public:
+    using value_type = T;
+
+    CountingAllocator() noexcept = default;
+    template <typename U> CountingAllocator(const CountingAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        allocated_bytes.fetch_add(static_cast<std::int64_t>(n * sizeof(T)), std::memory_order_relaxed);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T *pointer, std::size_t n) noexcept {
+        allocated_bytes.fetch_sub(static_cast<std::int64_t>(n * sizeof(T)), std::memory_order_relaxed);
+        std::allocator<T>().deallocate(pointer, n);
+    }
+
+    template <typename U> bool operator==(const CountingAllocator<U> &) const noexcept { return true; }
+};
+
+using Synchronized = ExpiringDataContainer<std::uint64_t>;
+using Unsynchronized = ExpiringDataContainer<std::uint64_t, UnsynchronizedPolicy>;
+using PerItem = ExpiringDataContainer<std::uint64_t, SynchronizedPolicy, Clock, PerItemTtlPolicy>;
+using Sharded = ShardedExpiringDataContainer<std::uint64_t>;
+using Instrumented = ExpiringDataContainer<std::uint64_t, SynchronizedPolicy, Clock, FixedTtlPolicy,
+                                           std::allocator<std::uint64_t>, NoAggregates, ContainerStats>;
+// holds the steady state window of a single inserting thread without evicting
+using Static = StaticExpiringDataContainer<std::uint64_t, steady_ttl.count(), 1 << 22>;
+
+// fills container with n elements inserted one microsecond apart, ending now, and returns the first insertion time
+template <typename Container> Clock::time_point fill(Container &container, std::size_t n) {
+    Clock::time_point first = Clock::now() - std::chrono::microseconds(n);
+    using Element = typename Container::Vector::value_type;
+    for (std::size_t i = 0; i < n; ++i) {
+        container.insert(Element(i), first + std::chrono::microseconds(i));
+    }
+    return first;
+}
+
+template <typename Container> void BM_Insert(benchmark::State &state) {
+    static std::unique_ptr<Container> container;
+    if (state.thread_index() == 0) {
+        container = std::make_unique<Container>(steady_ttl);
+    }
+    std::uint64_t value = 0;
+    for (auto _ : state) {
+        container->insert(value++);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        container.reset();
+    }
+}
+BENCHMARK(BM_Insert<Synchronized>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Insert<Sharded>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Insert<Unsynchronized>);
+BENCHMARK(BM_Insert<Static>);
+BENCHMARK(BM_Insert<Instrumented>)->ThreadRange(1, 8)->UseRealTime();
+
+// every iteration inserts state.range(0) elements one at a time
+void BM_InsertPerItem(benchmark::State &state) {
+    Synchronized container(steady_ttl);
+    std::vector<std::uint64_t> batch(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        for (std::uint64_t value : batch) {
+            container.insert(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InsertPerItem)->RangeMultiplier(16)->Range(1, 4096);
+
+// the same elements as BM_InsertPerItem, through a single insert_batch call
+void BM_InsertBatch(benchmark::State &state) {
+    Synchronized container(steady_ttl);
+    std::vector<std::uint64_t> batch(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        container.insert_batch(std::span<const std::uint64_t>(batch));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InsertBatch)->RangeMultiplier(16)->Range(1, 4096);
+
+template <typename Container> void BM_GetValidData(benchmark::State &state) {
+    Container container(long_ttl);
+    fill(container, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(container.get_valid_data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetValidData<Synchronized>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_GetValidData<PerItem>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_GetValidData<Sharded>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+
+// asks for the newest 64 elements, so the cost beyond copying them is finding where they start
+template <typename Container> void BM_GetDataExceeding(benchmark::State &state) {
+    Container container(long_ttl);
+    std::size_t n = static_cast<std::size_t>(state.range(0));
+    Clock::time_point first = fill(container, n);
+    Clock::time_point cut = first + std::chrono::microseconds(n - std::min<std::size_t>(n, 64)) -
+                            std::chrono::microseconds(1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(container.get_data_exceeding(cut));
+    }
+}
+BENCHMARK(BM_GetDataExceeding<Synchronized>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_GetDataExceeding<PerItem>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_GetDataExceeding<Sharded>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+
+// counts the newest half of the elements, with per item TTLs by scanning their expirations
+template <typename Container> void BM_CountBetween(benchmark::State &state) {
+    Container container(long_ttl);
+    std::size_t n = static_cast<std::size_t>(state.range(0));
+    Clock::time_point first = fill(container, n);
+    Clock::time_point from = first + std::chrono::microseconds(n / 2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(container.count_between(from, Clock::now()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) / 2);
+}
+BENCHMARK(BM_CountBetween<Synchronized>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_CountBetween<PerItem>)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+
+// writes a snapshot of state.range(0) elements to a buffer reused across iterations
+void BM_SnapshotTo(benchmark::State &state) {
+    Synchronized container(long_ttl);
+    fill(container, static_cast<std::size_t>(state.range(0)));
+    std::vector<std::byte> buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        container.snapshot_to(buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(buffer.size()));
+}
+BENCHMARK(BM_SnapshotTo)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+// restores a fresh container from a snapshot of state.range(0) elements
+void BM_RestoreFrom(benchmark::State &state) {
+    std::vector<std::byte> buffer;
+    {
+        Synchronized container(long_ttl);
+        fill(container, static_cast<std::size_t>(state.range(0)));
+        container.snapshot_to(buffer);
+    }
+    for (auto _ : state) {
+        Unsynchronized container(long_ttl);
+        benchmark::DoNotOptimize(container.restore_from(buffer));
+        state.PauseTiming();
+        container.tick(Clock::now() + 2 * long_ttl); // destroys the elements outside the timed region
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RestoreFrom)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+// refills the container with state.range(0) elements and hands them over to a buffer reused across iterations
+void BM_SwapOut(benchmark::State &state) {
+    Synchronized container(long_ttl);
+    std::vector<std::uint64_t> buffer;
+    for (auto _ : state) {
+        state.PauseTiming();
+        fill(container, static_cast<std::size_t>(state.range(0)));
+        state.ResumeTiming();
+        container.swap_out(buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SwapOut)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+// removes state.range(0) elements that all expired during a stall, in a single tick
+void BM_ExpireAfterStall(benchmark::State &state) {
+    using Manual = ExpiringDataContainer<std::uint64_t, UnsynchronizedPolicy, ManualClock>;
+    std::size_t n = static_cast<std::size_t>(state.range(0));
+    Manual container(std::chrono::milliseconds(1));
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (std::size_t i = 0; i < n; ++i) {
+            container.insert(i, ManualClock::now());
+        }
+        ManualClock::advance(std::chrono::milliseconds(2));
+        state.ResumeTiming();
+        container.tick(ManualClock::now());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ExpireAfterStall)->RangeMultiplier(32)->Range(1 << 5, 1 << 15);
+
+// the reported time is how long state.range(0) elements stay stored after they have expired
+void cleanup_lag(benchmark::State &state, Synchronized &container) {
+    std::vector<std::uint64_t> batch(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Clock::time_point now = Clock::now();
+        container.insert_batch(std::span<const std::uint64_t>(batch), now);
+        Clock::time_point expiration = now + std::chrono::milliseconds(1);
+        while (container.approximate_size() > 0) {
+            std::this_thread::yield();
+        }
+        state.SetIterationTime(std::chrono::duration<double>(Clock::now() - expiration).count());
+    }
+}
+
+void BM_CleanupLagThread(benchmark::State &state) {
+    Synchronized container(std::chrono::milliseconds(1));
+    cleanup_lag(state, container);
+}
+BENCHMARK(BM_CleanupLagThread)
+    ->RangeMultiplier(32)
+    ->Range(1, 1 << 15)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_CleanupLagScheduler(benchmark::State &state) {
+    ExpirationScheduler scheduler;
+    Synchronized container(std::chrono::milliseconds(1), scheduler);
+    cleanup_lag(state, container);
+}
+BENCHMARK(BM_CleanupLagScheduler)
+    ->RangeMultiplier(32)
+    ->Range(1, 1 << 15)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+template <typename Element> void BM_MemoryPerElement(benchmark::State &state) {
+    using Container = ExpiringDataContainer<Element, UnsynchronizedPolicy, Clock, FixedTtlPolicy,
+                                            CountingAllocator<Element>>;
+    std::size_t n = static_cast<std::size_t>(state.range(0));
+    std::int64_t bytes = 0;
+    for (auto _ : state) {
+        std::int64_t before = allocated_bytes.load(std::memory_order_relaxed);
+        Container container(long_ttl);
+        fill(container, n);
+        bytes = allocated_bytes.load(std::memory_order_relaxed) - before;
+    }
+    state.counters["bytes_per_element"] = static_cast<double>(bytes) / static_cast<double>(n);
+    state.counters["overhead_per_element"] =
+        static_cast<double>(bytes) / static_cast<double>(n) - static_cast<double>(sizeof(Element));
+}
+BENCHMARK(BM_MemoryPerElement<std::uint64_t>)->RangeMultiplier(32)->Range(1 << 5, 1 << 20);
+BENCHMARK(BM_MemoryPerElement<Payload>)->RangeMultiplier(32)->Range(1 << 5, 1 << 20);
+
+// the steady state of a window kept in memory mapped files in the working directory
+void BM_InsertSpilled(benchmark::State &state) {
+    using Spilled = ExpiringDataContainer<Payload, SynchronizedPolicy, Clock, FixedTtlPolicy,
+                                          MappedFileAllocator<Payload>>;
+    MappedFileResource spill(".");
+    Spilled container(steady_ttl, MappedFileAllocator<Payload>(spill));
+    std::uint64_t value = 0;
+    for (auto _ : state) {
+        container.insert(Payload(value++));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["spilled_bytes"] = static_cast<double>(spill.spilled_bytes());
+}
+BENCHMARK(BM_InsertSpilled);
+
+// even threads insert, odd threads read the elements inserted during the last 100 microseconds
+template <typename Container> void BM_MixedReadWrite(benchmark::State &state) {
+    static std::unique_ptr<Container> container;
+    if (state.thread_index() == 0) {
+        container = std::make_unique<Container>(steady_ttl);
+    }
+    bool writer = state.thread_index() % 2 == 0;
+    std::uint64_t value = 0;
+    std::size_t read = 0;
+    for (auto _ : state) {
+        if (writer) {
+            container->insert(value++);
+        } else {
+            read += container->get_data_exceeding(Clock::now() - std::chrono::microseconds(100)).size();
+        }
+    }
+    state.counters["inserts"] = benchmark::Counter(writer ? static_cast<double>(state.iterations()) : 0.0,
+                                                   benchmark::Counter::kIsRate);
+    state.counters["reads"] = benchmark::Counter(writer ? 0.0 : static_cast<double>(state.iterations()),
+                                                 benchmark::Counter::kIsRate);
+    state.counters["read_elements"] = benchmark::Counter(static_cast<double>(read), benchmark::Counter::kIsRate);
+    if (state.thread_index() == 0) {
+        container.reset();
+    }
+}
+BENCHMARK(BM_MixedReadWrite<Synchronized>)->ThreadRange(2, 8)->UseRealTime();
+BENCHMARK(BM_MixedReadWrite<Sharded>)->ThreadRange(2, 8)->UseRealTime();
+
+using Map = ExpiringDataMap<std::uint64_t, std::uint64_t>;
+
+void BM_MapFind(benchmark::State &state) {
+    Map map(long_ttl);
+    std::uint64_t n = static_cast<std::uint64_t>(state.range(0));
+    for (std::uint64_t key = 0; key < n; ++key) {
+        map.insert_or_refresh(key, key);
+    }
+    std::uint64_t key = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.find(key));
+        key = (key + 7919) % n;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MapFind)->RangeMultiplier(16)->Range(1 << 6, 1 << 22);
+
+// refreshes existing keys, so every iteration moves an entry to the back of the expiry list
+void BM_MapInsertOrRefresh(benchmark::State &state) {
+    Map map(long_ttl);
+    std::uint64_t n = static_cast<std::uint64_t>(state.range(0));
+    std::uint64_t key = 0;
+    for (auto _ : state) {
+        map.insert_or_refresh(key, key);
+        key = (key + 7919) % n;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MapInsertOrRefresh)->RangeMultiplier(16)->Range(1 << 6, 1 << 22);
+
+// state.range(0) IDs per window, every iteration tests and inserts a new one as a deduplicating consumer would
+void BM_DedupBloom(benchmark::State &state) {
+    std::size_t n = static_cast<std::size_t>(state.range(0));
+    ExpiringBloomFilter<std::uint64_t> filter(steady_ttl, n);
+    std::uint64_t id = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter.insert(id++));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes"] = static_cast<double>(filter.memory_bytes());
+}
+BENCHMARK(BM_DedupBloom)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
+
+void BM_DedupExact(benchmark::State &state) {
+    using Membership = MembershipAggregate<std::uint64_t>;
+    ExpiringDataContainer<std::uint64_t, SynchronizedPolicy, Clock, FixedTtlPolicy, std::allocator<std::uint64_t>,
+                          WindowAggregates<Membership>>
+        container(steady_ttl);
+    std::uint64_t id = 0;
+    for (auto _ : state) {
+        bool seen = container.read_aggregates([&](const auto &window) {
+            return window.template get<Membership>().contains(id);
+        });
+        if (!seen) {
+            container.insert(id);
+        }
+        ++id;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DedupExact);
+
+} // namespace
+
+BENCHMARK_MAIN();
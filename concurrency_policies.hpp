@@ -0,0 +1,108 @@
+#ifndef CONCURRENCY_POLICIES_HPP
+#define CONCURRENCY_POLICIES_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "spsc_ring.hpp"
+#include "time_ordered_storage.hpp"
+
+/*
+ * A concurrency policy decides how a container protects its state and who removes expired data:
+ *   Mutex                            the lock taken by every operation
+ *   background_cleanup               whether a cleanup thread or an ExpirationScheduler removes expired data
+ *   insert_evicts                    whether inserts remove expired data before appending
+ *   guards_shared_state              whether state besides the storage may be touched by any operation, which is
+ *                                    not the case when inserts and reads run on different threads without a lock
+ *   lock_free_reads                  whether reads traverse a view the storage publishes instead of taking the lock
+ *   ring_capacity                    the number of slots of a fixed size ring storage, 0 for a storage that grows
+ *   Storage<Slot, Stamp, Allocator>  the FIFO the elements are kept in, their stamps apart from them
+ */
+
+/**
+ * @brief A mutex that does nothing, for containers that do not need locking.
+ */
+struct NullMutex {
+    void lock() {}
+    void unlock() {}
+    bool try_lock() { return true; }
+};
+
+/**
+ * @brief The default policy, every operation takes a mutex and expired data is removed by a
+ * background cleanup thread or a shared ExpirationScheduler.
+ *
+ * Reads that only need a view of the valid data traverse the storage's published segment
+ * table instead, so any number of readers never delay an insert.
+ */
+struct SynchronizedPolicy {
+    using Mutex = std::mutex;
+    static constexpr bool background_cleanup = true;
+    static constexpr bool insert_evicts = false;
+    static constexpr bool guards_shared_state = true;
+    static constexpr bool lock_free_reads = true;
+    static constexpr std::size_t ring_capacity = 0;
+    template <typename Slot, typename Stamp, typename Allocator = std::allocator<Slot>>
+    using Storage = TimeOrderedStorage<Slot, Stamp, Allocator, true>;
+};
+
+/**
+ * @brief For single threaded use, there is no lock and no cleanup thread.
+ *
+ * Expired data is removed lazily by the container's own operations, or explicitly
+ * through tick().
+ */
+struct UnsynchronizedPolicy {
+    using Mutex = NullMutex;
+    static constexpr bool background_cleanup = false;
+    static constexpr bool insert_evicts = true;
+    static constexpr bool guards_shared_state = true;
+    static constexpr bool lock_free_reads = false;
+    static constexpr std::size_t ring_capacity = 0;
+    template <typename Slot, typename Stamp, typename Allocator = std::allocator<Slot>>
+    using Storage = TimeOrderedStorage<Slot, Stamp, Allocator>;
+};
+
+/**
+ * @brief For exactly one producer thread and one consumer thread, with no lock at all.
+ *
+ * The elements are kept in a lock-free SpscRing of Capacity slots. The producer may
+ * only insert, every other operation belongs to the consumer, which is also the one
+ * advancing the expiry head: there is no cleanup thread, expired data is removed by
+ * the consumer's reads or by tick(). Inserting into a full ring throws
+ * std::length_error, so the consumer has to keep up and Capacity has to cover a full
+ * TTL worth of inserts.
+ */
+template <std::size_t Capacity = 4096> struct SpscPolicy {
+    using Mutex = NullMutex;
+    static constexpr bool background_cleanup = false;
+    static constexpr bool insert_evicts = false;
+    static constexpr bool guards_shared_state = false;
+    static constexpr bool lock_free_reads = false;
+    static constexpr std::size_t ring_capacity = Capacity;
+    template <typename Slot, typename Stamp, typename Allocator = std::allocator<Slot>>
+    using Storage = SpscRing<Slot, Stamp, Capacity, Allocator>;
+};
+
+/**
+ * @brief For single threaded use like UnsynchronizedPolicy, with the elements in a ring of Capacity slots.
+ *
+ * Capacity is a power of two, so finding a slot is a mask instead of a walk over
+ * segments, and the ring is allocated once up front. The ring bounds the container:
+ * it holds at most Capacity elements, and what happens to an insert beyond that is up
+ * to the container's OverflowPolicy. A snapshot is only valid until the next operation
+ * that removes elements.
+ */
+template <std::size_t Capacity = 4096> struct RingPolicy {
+    using Mutex = NullMutex;
+    static constexpr bool background_cleanup = false;
+    static constexpr bool insert_evicts = true;
+    static constexpr bool guards_shared_state = true;
+    static constexpr bool lock_free_reads = false;
+    static constexpr std::size_t ring_capacity = Capacity;
+    template <typename Slot, typename Stamp, typename Allocator = std::allocator<Slot>>
+    using Storage = SpscRing<Slot, Stamp, Capacity, Allocator>;
+};
+
+#endif // CONCURRENCY_POLICIES_HPP
@@ -0,0 +1,98 @@
+#include "container_stats.hpp"
+
+#include <cmath>
+
+std::uint64_t Histogram::Snapshot::count() const {
+    std::uint64_t total = 0;
+    for (std::uint64_t bucket : counts) {
+        total += bucket;
+    }
+    return total;
+}
+
+std::uint64_t Histogram::Snapshot::percentile(double q) const {
+    std::uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    // the rank of the quantile among the recorded values, counted from 1
+    double wanted = std::ceil(q * static_cast<double>(total));
+    std::uint64_t rank = wanted < 1.0 ? 1 : static_cast<std::uint64_t>(wanted);
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return lower_bound(bucket);
+        }
+    }
+    return lower_bound(bucket_count - 1);
+}
+
+void Histogram::record(std::uint64_t value) noexcept {
+    counts[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t largest = max.load(std::memory_order_relaxed);
+    while (value > largest && !max.compare_exchange_weak(largest, value, std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot result;
+    for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        result.counts[bucket] = counts[bucket].load(std::memory_order_relaxed);
+    }
+    result.max = max.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::uint64_t Histogram::lower_bound(std::size_t bucket) {
+    if (bucket < 2 * sub_buckets) {
+        return bucket;
+    }
+    std::size_t shift = bucket / sub_buckets - 1;
+    return static_cast<std::uint64_t>(bucket % sub_buckets + sub_buckets) << shift;
+}
+
+ContainerStats::Snapshot ContainerStats::snapshot() const {
+    Snapshot result;
+    result.inserts = inserts.load(std::memory_order_relaxed);
+    result.rejected_inserts = rejected_inserts.load(std::memory_order_relaxed);
+    result.expirations = expirations.load(std::memory_order_relaxed);
+    result.evictions = evictions.load(std::memory_order_relaxed);
+    result.queries = queries.load(std::memory_order_relaxed);
+    result.sweeps = sweeps.load(std::memory_order_relaxed);
+    result.lock_acquisitions = lock_acquisitions.load(std::memory_order_relaxed);
+    result.contended_locks = contended_locks.load(std::memory_order_relaxed);
+    result.size_high_water = size_high_water.load(std::memory_order_relaxed);
+    result.lock_wait_ns = lock_wait.snapshot();
+    result.lock_hold_ns = lock_hold.snapshot();
+    result.cleanup_lag_ns = cleanup_lag.snapshot();
+    result.expired_per_sweep = expired_per_sweep.snapshot();
+    return result;
+}
+
+void ContainerStats::on_insert(std::size_t size) noexcept {
+    inserts.fetch_add(1, std::memory_order_relaxed);
+    // the plain load keeps the common case, a size below the mark, free of writes
+    std::uint64_t stored = static_cast<std::uint64_t>(size);
+    std::uint64_t mark = size_high_water.load(std::memory_order_relaxed);
+    while (stored > mark && !size_high_water.compare_exchange_weak(mark, stored, std::memory_order_relaxed)) {
+    }
+}
+
+void ContainerStats::on_sweep(std::size_t expired, std::chrono::nanoseconds lag) noexcept {
+    sweeps.fetch_add(1, std::memory_order_relaxed);
+    expired_per_sweep.record(expired);
+    cleanup_lag.record(ticks(lag));
+}
+
+void ContainerStats::on_lock(std::chrono::nanoseconds wait, bool contended) noexcept {
+    lock_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (contended) {
+        contended_locks.fetch_add(1, std::memory_order_relaxed);
+    }
+    lock_wait.record(ticks(wait));
+}
+
+void ContainerStats::on_unlock(std::chrono::nanoseconds hold) noexcept {
+    lock_hold.record(ticks(hold));
+}
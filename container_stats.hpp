@@ -0,0 +1,192 @@
+#ifndef CONTAINER_STATS_HPP
+#define CONTAINER_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Instrumentation is chosen at compile time through the Stats parameter of ExpiringDataContainer:
+ *   NoStats         the default, every hook is an empty inline function and the mutex is the policy's own
+ *   ContainerStats  atomic counters and histograms, read through the container's stats()
+ * A Stats type provides
+ *   enabled                whether there is anything to read
+ *   Mutex<Base>            the mutex the container locks, wrapping the policy's Base
+ *   Snapshot               what stats() returns
+ *   on_insert(size) and the other hooks below
+ */
+
+/**
+ * @brief An HDR-style histogram of non-negative 64 bit values, recorded lock free.
+ *
+ * Values below 16 get a bucket each, above that every power of two is split into 8
+ * buckets, so any value is known up to 12.5% of it across the whole 64 bit range in
+ * a fixed 496 buckets. Recording is a relaxed atomic increment.
+ */
+class Histogram {
+  public:
+    static constexpr std::size_t sub_buckets = 8;
+    static constexpr std::size_t bucket_count = 496;
+
+    /**
+     * @brief The counts of a histogram at one point in time, a plain value to export or compare.
+     */
+    struct Snapshot {
+        std::array<std::uint64_t, bucket_count> counts{};
+        std::uint64_t max = 0;
+
+        std::uint64_t count() const;
+        /**
+         * @brief The lower bound of the bucket holding the q quantile for q in [0, 1], 0 for an empty histogram.
+         */
+        std::uint64_t percentile(double q) const;
+    };
+
+    void record(std::uint64_t value) noexcept;
+    Snapshot snapshot() const;
+
+    static std::size_t bucket_of(std::uint64_t value) {
+        std::size_t width = static_cast<std::size_t>(std::bit_width(value));
+        if (width <= 4) {
+            return static_cast<std::size_t>(value);
+        }
+        std::size_t shift = width - 4;
+        return sub_buckets * shift + static_cast<std::size_t>(value >> shift);
+    }
+    // the smallest value counted in bucket
+    static std::uint64_t lower_bound(std::size_t bucket);
+
+  private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> counts{};
+    std::atomic<std::uint64_t> max{0};
+};
+
+class ContainerStats;
+
+/**
+ * @brief Wraps the mutex of an instrumented container to time how long it is waited for and held.
+ *
+ * Times come from steady_clock whatever the container's clock, and every acquisition
+ * that finds the mutex taken counts as contended.
+ */
+template <typename Base> class InstrumentedMutex {
+  public:
+    void attach(ContainerStats &stats) { this->stats = &stats; }
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+  private:
+    Base base;
+    ContainerStats *stats = nullptr;
+    std::chrono::steady_clock::time_point locked_at; // only touched by the holder
+};
+
+/**
+ * @brief The stats of a container that keeps none.
+ */
+struct NoStats {
+    static constexpr bool enabled = false;
+    template <typename Base> using Mutex = Base;
+
+    struct Snapshot {};
+
+    void on_insert(std::size_t) {}
+    void on_reject() {}
+    void on_expire(std::size_t) {}
+    void on_evict() {}
+    void on_query() {}
+    void on_sweep(std::size_t, std::chrono::nanoseconds) {}
+};
+
+/**
+ * @brief Counters and histograms of everything a container does, for scraping by a metrics exporter.
+ *
+ * Every hook is a relaxed atomic update, so reading a snapshot never blocks the
+ * container, and the counters of one snapshot are each exact but not necessarily taken
+ * at the same instant. Lock times need a lock, so SPSC containers cannot be instrumented.
+ */
+class ContainerStats {
+  public:
+    static constexpr bool enabled = true;
+    template <typename Base> using Mutex = InstrumentedMutex<Base>;
+
+    struct Snapshot {
+        std::uint64_t inserts = 0;
+        std::uint64_t rejected_inserts = 0; // by a full container with OverflowPolicy::reject
+        std::uint64_t expirations = 0;      // elements removed because they expired
+        std::uint64_t evictions = 0;        // elements removed early to make room
+        std::uint64_t queries = 0;          // snapshots, count_between, cursor reads and read_aggregates
+        std::uint64_t sweeps = 0;           // runs of the cleanup thread or scheduler that removed anything
+        std::uint64_t lock_acquisitions = 0;
+        std::uint64_t contended_locks = 0;
+        std::uint64_t size_high_water = 0; // the most elements ever stored at once
+        Histogram::Snapshot lock_wait_ns;
+        Histogram::Snapshot lock_hold_ns;
+        Histogram::Snapshot cleanup_lag_ns;    // per sweep, how long after its expiration the oldest element went
+        Histogram::Snapshot expired_per_sweep;
+    };
+
+    Snapshot snapshot() const;
+
+    void on_insert(std::size_t size) noexcept;
+    void on_reject() noexcept { rejected_inserts.fetch_add(1, std::memory_order_relaxed); }
+    void on_expire(std::size_t n) noexcept { expirations.fetch_add(n, std::memory_order_relaxed); }
+    void on_evict() noexcept { evictions.fetch_add(1, std::memory_order_relaxed); }
+    void on_query() noexcept { queries.fetch_add(1, std::memory_order_relaxed); }
+    void on_sweep(std::size_t expired, std::chrono::nanoseconds lag) noexcept;
+    void on_lock(std::chrono::nanoseconds wait, bool contended) noexcept;
+    void on_unlock(std::chrono::nanoseconds hold) noexcept;
+
+  private:
+    static std::uint64_t ticks(std::chrono::nanoseconds time) {
+        return time.count() > 0 ? static_cast<std::uint64_t>(time.count()) : 0;
+    }
+
+    std::atomic<std::uint64_t> inserts{0};
+    std::atomic<std::uint64_t> rejected_inserts{0};
+    std::atomic<std::uint64_t> expirations{0};
+    std::atomic<std::uint64_t> evictions{0};
+    std::atomic<std::uint64_t> queries{0};
+    std::atomic<std::uint64_t> sweeps{0};
+    std::atomic<std::uint64_t> lock_acquisitions{0};
+    std::atomic<std::uint64_t> contended_locks{0};
+    std::atomic<std::uint64_t> size_high_water{0};
+    Histogram lock_wait;
+    Histogram lock_hold;
+    Histogram cleanup_lag;
+    Histogram expired_per_sweep;
+};
+
+template <typename Base> void InstrumentedMutex<Base>::lock() {
+    if (base.try_lock()) {
+        locked_at = std::chrono::steady_clock::now();
+        stats->on_lock(std::chrono::nanoseconds(0), false);
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    base.lock();
+    locked_at = std::chrono::steady_clock::now();
+    stats->on_lock(locked_at - start, true);
+}
+
+template <typename Base> bool InstrumentedMutex<Base>::try_lock() {
+    if (!base.try_lock()) {
+        return false;
+    }
+    locked_at = std::chrono::steady_clock::now();
+    stats->on_lock(std::chrono::nanoseconds(0), false);
+    return true;
+}
+
+template <typename Base> void InstrumentedMutex<Base>::unlock() {
+    auto held = std::chrono::steady_clock::now() - locked_at;
+    base.unlock();
+    stats->on_unlock(held);
+}
+
+#endif // CONTAINER_STATS_HPP
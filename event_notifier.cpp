@@ -0,0 +1,64 @@
+#include "event_notifier.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+EventNotifier::EventNotifier() {
+#if defined(__linux__)
+    read_end = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (read_end < 0) {
+        throw std::system_error(errno, std::system_category(), "eventfd");
+    }
+    write_end = read_end;
+#else
+    int ends[2];
+    if (pipe(ends) != 0) {
+        throw std::system_error(errno, std::system_category(), "pipe");
+    }
+    for (int end : ends) {
+        fcntl(end, F_SETFL, fcntl(end, F_GETFL) | O_NONBLOCK);
+        fcntl(end, F_SETFD, FD_CLOEXEC);
+    }
+    read_end = ends[0];
+    write_end = ends[1];
+#endif
+}
+
+EventNotifier::~EventNotifier() {
+    if (write_end != read_end) {
+        close(write_end);
+    }
+    close(read_end);
+}
+
+void EventNotifier::signal() {
+    if (pending.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    // a full pipe or eventfd counter is readable already, so a failed write loses nothing
+#if defined(__linux__)
+    std::uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(write_end, &one, sizeof(one));
+#else
+    char byte = 1;
+    [[maybe_unused]] ssize_t written = write(write_end, &byte, 1);
+#endif
+}
+
+bool EventNotifier::consume() {
+    // drained before pending is cleared, the other way round a signal in between would be swallowed
+    bool drained = false;
+    char buffer[64];
+    while (read(read_end, buffer, sizeof(buffer)) > 0) {
+        drained = true;
+    }
+    pending.store(false, std::memory_order_release);
+    return drained;
+}
@@ -0,0 +1,44 @@
+#ifndef EVENT_NOTIFIER_HPP
+#define EVENT_NOTIFIER_HPP
+
+#include <atomic>
+
+/**
+ * @brief A file descriptor that turns readable when an event is signaled, for epoll, poll or io_uring loops.
+ *
+ * Backed by an eventfd on Linux and by a pipe on other POSIX systems. Signals are
+ * coalesced: however many arrive before the next consume(), the descriptor is written
+ * to once, so a busy consumer keeps the signaling side off the system call path.
+ * signal() may be called from any thread, consume() from the consumer's.
+ */
+class EventNotifier {
+  public:
+    /**
+     * @brief Throws std::system_error when the descriptor cannot be created.
+     */
+    EventNotifier();
+    ~EventNotifier();
+
+    EventNotifier(const EventNotifier &) = delete;
+    EventNotifier &operator=(const EventNotifier &) = delete;
+
+    // non-blocking, readable while a signal is pending
+    int fd() const { return read_end; }
+
+    void signal();
+
+    /**
+     * @brief Clears the pending signal, returns whether there was one.
+     *
+     * Call this before looking at what was signaled, so that a signal arriving while
+     * the consumer works makes the descriptor readable again.
+     */
+    bool consume();
+
+  private:
+    int read_end = -1;
+    int write_end = -1; // the same descriptor as read_end for an eventfd
+    std::atomic<bool> pending{false};
+};
+
+#endif // EVENT_NOTIFIER_HPP
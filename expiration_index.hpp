@@ -0,0 +1,72 @@
+#ifndef EXPIRATION_INDEX_HPP
+#define EXPIRATION_INDEX_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+
+#include "timer_wheel.hpp"
+
+/**
+ * @brief Tracks which elements of a time ordered storage have expired when every element has its own TTL.
+ *
+ * With per element TTLs the elements no longer expire in insertion order, so the storage
+ * alone cannot tell what has expired. The index gives every element a sequence number in
+ * insertion order and schedules it in a TimerWheel at its expiration, with a resolution of
+ * one millisecond. Advancing the index marks the elements whose timers fired and keeps a
+ * count of the live ones, which is O(1) amortized per element. The storage can then pop
+ * its front for as long as the front is marked, an element that expired behind a longer
+ * lived one stays in the storage until the front reaches it.
+ *
+ * The marks are kept apart from the storage so that snapshots of the storage are never
+ * written to, readers skip expired elements by comparing their expiration with the time.
+ */
+template <typename Clock, typename Allocator = std::allocator<std::uint64_t>> class ExpirationIndex {
+  public:
+    using TimePoint = typename Clock::time_point;
+    using Resolution = std::chrono::milliseconds;
+
+    explicit ExpirationIndex(const Allocator &allocator = Allocator())
+        : wheel(ticks_until(Clock::now()), allocator), expired(allocator) {}
+
+    void on_insert(TimePoint expiration);
+
+    // must be called for every element leaving the front of the storage
+    void on_pop_front();
+
+    // marks every element whose expiration has been reached by now
+    void advance(TimePoint now);
+
+    bool front_expired() const { return !expired.empty() && expired.front(); }
+    std::size_t live_count() const { return live; }
+
+    /**
+     * @brief Returns a time no later than the next expiration, or nothing when every element has expired.
+     */
+    std::optional<TimePoint> next_deadline() const;
+
+  private:
+    static std::uint64_t ticks_until(TimePoint time);
+
+    template <typename U> using Rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+    TimerWheel<std::uint64_t, Rebind<std::uint64_t>> wheel; // holds sequence numbers
+    std::deque<bool, Rebind<bool>> expired; // expired[i] belongs to the element with sequence number front_sequence + i
+    std::uint64_t front_sequence = 0;
+    std::size_t live = 0;
+};
+
+/**
+ * @brief Stands in for an ExpirationIndex when every element has the same TTL and the storage order suffices.
+ */
+struct NoExpirationIndex {
+    NoExpirationIndex() = default;
+    template <typename Allocator> explicit NoExpirationIndex(const Allocator &) {}
+};
+
+#include "expiration_index.tpp"
+
+#endif // EXPIRATION_INDEX_HPP
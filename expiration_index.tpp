@@ -0,0 +1,49 @@
+#include "expiration_index.hpp"
+
+template <typename Clock, typename Allocator>
+void ExpirationIndex<Clock, Allocator>::on_insert(TimePoint expiration) {
+    std::uint64_t sequence = front_sequence + expired.size();
+    // rounding the deadline up means the timer never fires before the expiration
+    wheel.schedule(ticks_until(expiration), sequence);
+    expired.push_back(false);
+    ++live;
+}
+
+template <typename Clock, typename Allocator>
+void ExpirationIndex<Clock, Allocator>::on_pop_front() {
+    if (!expired.front()) {
+        // removed before it expired, its timer is ignored when it fires
+        --live;
+    }
+    expired.pop_front();
+    ++front_sequence;
+}
+
+template <typename Clock, typename Allocator>
+void ExpirationIndex<Clock, Allocator>::advance(TimePoint now) {
+    auto elapsed = std::chrono::floor<Resolution>(now.time_since_epoch()).count();
+    if (elapsed < 0) {
+        return;
+    }
+    wheel.advance(static_cast<std::uint64_t>(elapsed), [this](std::uint64_t, std::uint64_t sequence) {
+        if (sequence >= front_sequence) {
+            expired[sequence - front_sequence] = true;
+            --live;
+        }
+    });
+}
+
+template <typename Clock, typename Allocator>
+std::optional<typename ExpirationIndex<Clock, Allocator>::TimePoint> ExpirationIndex<Clock, Allocator>::next_deadline() const {
+    std::optional<std::uint64_t> tick = wheel.next_tick();
+    if (!tick || live == 0) {
+        return std::nullopt;
+    }
+    return TimePoint(std::chrono::duration_cast<typename Clock::duration>(Resolution(*tick)));
+}
+
+template <typename Clock, typename Allocator>
+std::uint64_t ExpirationIndex<Clock, Allocator>::ticks_until(TimePoint time) {
+    auto ticks = std::chrono::ceil<Resolution>(time.time_since_epoch()).count();
+    return ticks < 0 ? 0 : static_cast<std::uint64_t>(ticks);
+}
@@ -0,0 +1,74 @@
+#ifndef EXPIRATION_POLICIES_HPP
+#define EXPIRATION_POLICIES_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include "expiration_index.hpp"
+
+/*
+ * An expiration policy decides how a container finds out what has expired:
+ *   per_item_ttl             whether inserts may give an element its own TTL
+ *   static_ttl               whether the fixed duration is the compile time constant ttl instead of a member
+ *   Index<Clock, Allocator>  the expiration index kept next to the storage
+ *   Stamp<TimePoint>         what the storage keeps about every element besides the element itself
+ */
+
+/**
+ * @brief When an element was inserted, which is all there is to know when every element lives equally long.
+ */
+template <typename TimePoint> struct InsertionStamp {
+    TimePoint insertion;
+};
+
+/**
+ * @brief When an element was inserted and when it expires.
+ */
+template <typename TimePoint> struct ExpirationStamp {
+    TimePoint insertion;
+    TimePoint expiration;
+};
+
+/**
+ * @brief The default policy, every element lives for the container's fixed duration.
+ *
+ * Expiration order is insertion order, so the storage is a plain FIFO and there is no
+ * index at all.
+ */
+struct FixedTtlPolicy {
+    static constexpr bool per_item_ttl = false;
+    static constexpr bool static_ttl = false;
+    template <typename Clock, typename Allocator> using Index = NoExpirationIndex;
+    // the expiration is always the insertion plus the fixed duration, so it is not stored
+    template <typename TimePoint> using Stamp = InsertionStamp<TimePoint>;
+};
+
+/**
+ * @brief Every element can be given its own TTL, the container's duration is only the default.
+ *
+ * Expiration is tracked by an ExpirationIndex, see there for the costs.
+ */
+struct PerItemTtlPolicy {
+    static constexpr bool per_item_ttl = true;
+    static constexpr bool static_ttl = false;
+    template <typename Clock, typename Allocator> using Index = ExpirationIndex<Clock, Allocator>;
+    template <typename TimePoint> using Stamp = ExpirationStamp<TimePoint>;
+};
+
+/**
+ * @brief Like FixedTtlPolicy, with every element living for a duration fixed at compile time.
+ *
+ * Every expiration is the insertion plus a constant, which the compiler folds into the
+ * expiry checks and the cleanup deadlines instead of loading the container's duration.
+ */
+template <std::int64_t Milliseconds> struct StaticTtlPolicy {
+    static_assert(Milliseconds > 0, "elements must live for a positive duration");
+
+    static constexpr bool per_item_ttl = false;
+    static constexpr bool static_ttl = true;
+    static constexpr std::chrono::milliseconds ttl{Milliseconds};
+    template <typename Clock, typename Allocator> using Index = NoExpirationIndex;
+    template <typename TimePoint> using Stamp = InsertionStamp<TimePoint>;
+};
+
+#endif // EXPIRATION_POLICIES_HPP
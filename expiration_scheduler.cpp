@@ -0,0 +1,115 @@
+#include "expiration_scheduler.hpp"
+
+ExpirationScheduler::ExpirationScheduler(std::chrono::milliseconds tick)
+    : tick(tick), epoch(Clock::now()), worker(&ExpirationScheduler::run, this) {}
+
+ExpirationScheduler::~ExpirationScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    wake_cv.notify_all();
+    worker.join();
+}
+
+ExpirationScheduler::RegistrationId ExpirationScheduler::add(Sweep sweep) {
+    std::lock_guard<std::mutex> lock(mtx);
+    RegistrationId id = next_id++;
+    registrations.emplace(id, Registration{std::move(sweep), std::nullopt});
+    return id;
+}
+
+void ExpirationScheduler::remove(RegistrationId id) {
+    std::unique_lock<std::mutex> lock(mtx);
+    sweep_done.wait(lock, [this, id] { return running != id; });
+    // the timer left in the wheel is ignored when it fires
+    registrations.erase(id);
+}
+
+void ExpirationScheduler::schedule(RegistrationId id, TimePoint deadline) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = registrations.find(id);
+    if (it != registrations.end()) {
+        schedule_locked(it->second, id, deadline);
+    }
+}
+
+void ExpirationScheduler::schedule_locked(Registration &registration, RegistrationId id, TimePoint deadline) {
+    std::uint64_t deadline_tick = first_tick_not_before(deadline);
+    if (registration.scheduled_tick && *registration.scheduled_tick <= deadline_tick) {
+        return;
+    }
+    // an earlier timer supersedes the one already in the wheel, which is ignored when it fires
+    registration.scheduled_tick = deadline_tick;
+    wheel.schedule(deadline_tick, Timer{id});
+    if (sleeping_until && deadline_tick < *sleeping_until) {
+        wake_cv.notify_one();
+    }
+}
+
+void ExpirationScheduler::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    std::vector<RegistrationId> due;
+    while (!stop) {
+        TimePoint now = Clock::now();
+        due.clear();
+        wheel.advance(ticks_elapsed_at(now), [this, &due](std::uint64_t deadline_tick, Timer timer) {
+            auto it = registrations.find(timer.id);
+            if (it != registrations.end() && it->second.scheduled_tick == deadline_tick) {
+                it->second.scheduled_tick.reset();
+                due.push_back(timer.id);
+            }
+        });
+
+        for (RegistrationId id : due) {
+            auto it = registrations.find(id);
+            if (it == registrations.end()) {
+                continue;
+            }
+            // remove() waits while running is set, so the registration outlives the unlocked call
+            Registration &registration = it->second;
+            running = id;
+            lock.unlock();
+            std::optional<TimePoint> next_deadline = registration.sweep(now);
+            lock.lock();
+            running = 0;
+            sweep_done.notify_all();
+            if (next_deadline) {
+                schedule_locked(registration, id, *next_deadline);
+            }
+        }
+
+        if (stop) {
+            break;
+        }
+        std::optional<std::uint64_t> next_tick = wheel.next_tick();
+        if (next_tick) {
+            sleeping_until = *next_tick;
+            wake_cv.wait_until(lock, tick_start(*next_tick));
+        } else {
+            sleeping_until = std::numeric_limits<std::uint64_t>::max();
+            wake_cv.wait(lock);
+        }
+        sleeping_until.reset();
+    }
+}
+
+std::uint64_t ExpirationScheduler::ticks_elapsed_at(TimePoint time) const {
+    if (time <= epoch) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>((time - epoch) / tick);
+}
+
+std::uint64_t ExpirationScheduler::first_tick_not_before(TimePoint time) const {
+    if (time <= epoch) {
+        return 0;
+    }
+    auto elapsed = time - epoch;
+    auto ticks = static_cast<std::uint64_t>(elapsed / tick);
+    return elapsed % tick == Clock::duration::zero() ? ticks : ticks + 1;
+}
+
+ExpirationScheduler::TimePoint ExpirationScheduler::tick_start(std::uint64_t tick_index) const {
+    return epoch + tick * tick_index;
+}
@@ -0,0 +1,97 @@
+#ifndef EXPIRATION_SCHEDULER_HPP
+#define EXPIRATION_SCHEDULER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+/**
+ * @brief A single cleanup thread shared by many expiring containers.
+ *
+ * Instead of every container running its own cleanup thread, containers can register
+ * with a scheduler. Each registration has at most one pending deadline, kept in a
+ * hierarchical TimerWheel, and when it is reached the scheduler calls the
+ * registration's sweep function, which removes whatever has expired and returns the
+ * next deadline, if any. This keeps the cost of thousands of mostly idle containers
+ * down to one thread and one wheel entry each.
+ *
+ * Sweep functions run on the scheduler thread without the scheduler lock held, so
+ * they may take their own container lock. Containers must not call schedule while
+ * holding their own lock. Every container registered with a scheduler must be
+ * destroyed before the scheduler.
+ */
+class ExpirationScheduler {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+    using RegistrationId = std::uint64_t;
+
+    // removes expired data as of now and returns the next time anything expires
+    using Sweep = std::function<std::optional<TimePoint>(TimePoint now)>;
+
+    /**
+     * @param tick the resolution of the timer wheel, deadlines are met up to one tick late
+     */
+    explicit ExpirationScheduler(std::chrono::milliseconds tick = std::chrono::milliseconds(1));
+    ~ExpirationScheduler();
+
+    ExpirationScheduler(const ExpirationScheduler &) = delete;
+    ExpirationScheduler &operator=(const ExpirationScheduler &) = delete;
+
+    RegistrationId add(Sweep sweep);
+
+    /**
+     * @brief Unregisters a sweep function, waiting for it to return if it is running right now.
+     *
+     * Once this returns the sweep function is never called again.
+     */
+    void remove(RegistrationId id);
+
+    /**
+     * @brief Makes sure the registration is swept no later than deadline.
+     *
+     * Does nothing if an earlier sweep is already pending.
+     */
+    void schedule(RegistrationId id, TimePoint deadline);
+
+  private:
+    struct Registration {
+        Sweep sweep;
+        std::optional<std::uint64_t> scheduled_tick;
+    };
+
+    struct Timer {
+        RegistrationId id;
+    };
+
+    void run();
+    void schedule_locked(Registration &registration, RegistrationId id, TimePoint deadline);
+    std::uint64_t ticks_elapsed_at(TimePoint time) const;
+    std::uint64_t first_tick_not_before(TimePoint time) const;
+    TimePoint tick_start(std::uint64_t tick) const;
+
+    const std::chrono::milliseconds tick;
+    const TimePoint epoch;
+    TimerWheel<Timer> wheel;
+    std::unordered_map<RegistrationId, Registration> registrations;
+    RegistrationId next_id = 1;
+    RegistrationId running = 0; // the registration whose sweep is running, 0 when none is
+    std::optional<std::uint64_t> sleeping_until; // set while the worker waits, so schedule knows when to wake it
+    bool stop = false;
+
+    std::mutex mtx;
+    std::condition_variable wake_cv;    // wakes the scheduler thread
+    std::condition_variable sweep_done; // wakes remove() waiting for a running sweep
+    std::thread worker;
+};
+
+#endif // EXPIRATION_SCHEDULER_HPP
@@ -0,0 +1,97 @@
+#ifndef EXPIRING_BLOOM_FILTER_HPP
+#define EXPIRING_BLOOM_FILTER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "concurrency_policies.hpp"
+
+/**
+ * @brief Approximate membership of the keys inserted during the last fixed duration, in bounded memory.
+ *
+ * The window is cut into time slices of duration / (slices - 1), each with a Bloom filter
+ * of its own. Inserts go to the slice of the current time, lookups ask every slice, and
+ * once time moves past the window the oldest slice is cleared and reused for the newest.
+ * A key therefore stays visible for at least duration after it was inserted and at most
+ * one slice longer, and is never missed within that time.
+ *
+ * The filters are blocked: a key only ever touches the 512 bits of one cache line per
+ * slice, so inserting and looking up cost a cache miss per slice whatever the number of
+ * hash functions. The filters are sized from the number of keys expected per window,
+ * assumed to arrive at a steady rate, so that the false positive rate of a lookup across
+ * all slices stays near false_positive_rate. More keys than expected raise it, they never
+ * grow the filter.
+ *
+ * With SynchronizedPolicy every operation takes a mutex, with UnsynchronizedPolicy none.
+ * Times must not go backwards, an earlier time than the previous one is treated as it.
+ * ExpiringDataContainer with a MembershipAggregate is the exact counterpart.
+ */
+template <typename Key, typename ConcurrencyPolicy = SynchronizedPolicy,
+          typename ClockType = std::chrono::steady_clock, typename Hash = std::hash<Key>>
+class ExpiringBloomFilter {
+  public:
+    using Clock = ClockType;
+    using TimePoint = std::chrono::time_point<Clock>;
+    using Duration = std::chrono::milliseconds;
+    using Mutex = typename ConcurrencyPolicy::Mutex;
+
+    /**
+     * @brief Throws std::invalid_argument unless duration and expected_per_window are positive,
+     * false_positive_rate lies strictly between 0 and 1 and there are at least 2 slices.
+     */
+    ExpiringBloomFilter(Duration duration, std::size_t expected_per_window, double false_positive_rate = 0.01,
+                        std::size_t slices = 4);
+
+    /**
+     * @brief Adds key to the window, returns false if it may have been inserted already.
+     *
+     * A true result is certain, so testing and inserting a message ID is a single call.
+     */
+    bool insert(const Key &key);
+    bool insert(const Key &key, TimePoint now);
+
+    // false is certain, true is wrong at about the false positive rate
+    bool contains(const Key &key);
+    bool contains(const Key &key, TimePoint now);
+
+    // the bytes taken by the filters, fixed at construction
+    std::size_t memory_bytes() const { return bits.size() * sizeof(std::uint64_t); }
+    std::size_t hash_count() const { return hashes; }
+
+  private:
+    static constexpr std::size_t block_words = 8; // 512 bits, one cache line
+
+    struct Probe {
+        std::size_t block; // within a slice
+        std::uint64_t first;
+        std::uint64_t step; // odd, so the k bit positions of a key differ
+    };
+
+    Probe probe_of(const Key &key) const;
+    bool test(std::size_t slice, const Probe &probe) const;
+    void set(std::size_t slice, const Probe &probe);
+    void advance(TimePoint now);
+
+    [[no_unique_address]] Hash hasher;
+    std::size_t slice_count;
+    typename Clock::duration slice_width;
+    std::size_t blocks_per_slice;
+    std::size_t hashes;
+    std::vector<std::uint64_t> bits;   // slice_count slices of blocks_per_slice blocks each
+    std::vector<std::size_t> inserted; // per slice, lookups skip the empty ones
+    std::size_t current = 0;           // the slice taking inserts
+    std::int64_t current_serial = std::numeric_limits<std::int64_t>::min(); // slice_width periods since the epoch
+    mutable Mutex mtx;
+};
+
+#include "expiring_bloom_filter.tpp"
+
+#endif // EXPIRING_BLOOM_FILTER_HPP
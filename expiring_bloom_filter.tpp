@@ -0,0 +1,129 @@
+#include "expiring_bloom_filter.hpp"
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::ExpiringBloomFilter(
+    Duration duration, std::size_t expected_per_window, double false_positive_rate, std::size_t slices)
+    : slice_count(slices) {
+    if (duration <= Duration::zero() || expected_per_window == 0) {
+        throw std::invalid_argument("ExpiringBloomFilter needs a positive duration and expected key count");
+    }
+    if (!(false_positive_rate > 0.0 && false_positive_rate < 1.0)) {
+        throw std::invalid_argument("ExpiringBloomFilter false positive rate must lie between 0 and 1");
+    }
+    if (slices < 2) {
+        throw std::invalid_argument("ExpiringBloomFilter needs at least 2 slices");
+    }
+    // rounded up, so that the slices - 1 slices before the current one cover at least duration
+    std::size_t periods = slices - 1;
+    auto window = std::chrono::ceil<typename Clock::duration>(duration).count();
+    slice_width = typename Clock::duration((window + static_cast<decltype(window)>(periods) - 1) /
+                                            static_cast<decltype(window)>(periods));
+    // a window is spread over slices - 1 slices and a lookup may go wrong in any slice, the rate is halved
+    // again for the blocks, which fill less evenly than a single filter over the whole slice would
+    double per_slice = std::ceil(static_cast<double>(expected_per_window) / static_cast<double>(periods));
+    double slice_rate = false_positive_rate / static_cast<double>(2 * slices);
+    double ln2 = std::log(2.0);
+    double slice_bits = std::ceil(-per_slice * std::log(slice_rate) / (ln2 * ln2));
+    blocks_per_slice = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(slice_bits / 512.0)));
+    double optimal = static_cast<double>(blocks_per_slice * 512) / per_slice * ln2;
+    hashes = std::clamp<std::size_t>(static_cast<std::size_t>(std::lround(optimal)), 1, 16);
+    bits.assign(slices * blocks_per_slice * block_words, 0);
+    inserted.assign(slices, 0);
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+bool ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::insert(const Key &key) {
+    return insert(key, Clock::now());
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+bool ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::insert(const Key &key, TimePoint now) {
+    std::lock_guard<Mutex> lock(mtx);
+    advance(now);
+    Probe probe = probe_of(key);
+    bool seen = false;
+    for (std::size_t slice = 0; slice < slice_count && !seen; ++slice) {
+        seen = inserted[slice] > 0 && test(slice, probe);
+    }
+    // set even when seen, a key inserted again stays visible for another duration
+    set(current, probe);
+    ++inserted[current];
+    return !seen;
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+bool ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::contains(const Key &key) {
+    return contains(key, Clock::now());
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+bool ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::contains(const Key &key, TimePoint now) {
+    std::lock_guard<Mutex> lock(mtx);
+    advance(now);
+    Probe probe = probe_of(key);
+    for (std::size_t slice = 0; slice < slice_count; ++slice) {
+        if (inserted[slice] > 0 && test(slice, probe)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+typename ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::Probe
+ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::probe_of(const Key &key) const {
+    // splitmix64's finalizer, std::hash is the identity for integers
+    std::uint64_t hash = static_cast<std::uint64_t>(hasher(key));
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    // the high half picks the block, the low bits the positions within it
+    std::size_t block = static_cast<std::size_t>(((hash >> 32) * blocks_per_slice) >> 32);
+    return Probe{block, hash, (hash >> 9) | 1};
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+bool ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::test(std::size_t slice, const Probe &probe) const {
+    const std::uint64_t *block = bits.data() + (slice * blocks_per_slice + probe.block) * block_words;
+    std::uint64_t position = probe.first;
+    for (std::size_t i = 0; i < hashes; ++i, position += probe.step) {
+        std::size_t bit = static_cast<std::size_t>(position % (block_words * 64));
+        if ((block[bit / 64] >> (bit % 64) & 1) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+void ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::set(std::size_t slice, const Probe &probe) {
+    std::uint64_t *block = bits.data() + (slice * blocks_per_slice + probe.block) * block_words;
+    std::uint64_t position = probe.first;
+    for (std::size_t i = 0; i < hashes; ++i, position += probe.step) {
+        std::size_t bit = static_cast<std::size_t>(position % (block_words * 64));
+        block[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    }
+}
+
+template <typename Key, typename ConcurrencyPolicy, typename ClockType, typename Hash>
+void ExpiringBloomFilter<Key, ConcurrencyPolicy, ClockType, Hash>::advance(TimePoint now) {
+    std::int64_t serial = static_cast<std::int64_t>(now.time_since_epoch() / slice_width);
+    if (serial <= current_serial) {
+        return;
+    }
+    if (current_serial == std::numeric_limits<std::int64_t>::min()) {
+        current_serial = serial;
+        return;
+    }
+    // after a pause longer than the window every slice is cleared once, not once per period
+    std::int64_t steps = std::min(serial - current_serial, static_cast<std::int64_t>(slice_count));
+    for (; steps > 0; --steps) {
+        current = (current + 1) % slice_count;
+        if (inserted[current] > 0) {
+            auto first = bits.begin() + static_cast<std::ptrdiff_t>(current * blocks_per_slice * block_words);
+            std::fill(first, first + static_cast<std::ptrdiff_t>(blocks_per_slice * block_words), 0);
+            inserted[current] = 0;
+        }
+    }
+    current_serial = serial;
+}
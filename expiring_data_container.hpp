@@ -2,13 +2,44 @@
 #define EXPIRING_DATA_CONTAINER_HPP
 
 #include <chrono>
-#include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
-#include <deque>
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <span>
+#include <optional>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <coroutine>
+#include <bit>
+#include <array>
+#include <cstring>
+
+#include "concurrency_policies.hpp"
+#include "container_stats.hpp"
+#include "event_notifier.hpp"
+#include "expiration_policies.hpp"
+#include "expiration_scheduler.hpp"
+#include "snapshot_io.hpp"
+#include "time_ordered_storage.hpp"
+#include "timestamp_scan.hpp"
+#include "window_aggregates.hpp"
+
+/**
+ * @brief What a bounded container does with an insert when it is full.
+ */
+enum class OverflowPolicy {
+    evict_oldest, // removes the oldest element, whether it has expired or not
+    reject,       // drops the new element, the insert returns false
+    block,        // waits until an element expires or is drained, a single threaded container sleeps
+};
 
 /**
  * @brief A data structure that holds data with a fixed duration.
@@ -18,50 +49,560 @@
  * and is automatically removed after that time has elapsed.
  *
  * Multiple threads are used to manage data insertion, removal of expired data,
- * and retrieval of valid data. A cleanup thread periodically removes expired
- * data elements. Mutexes are used to ensure thread safety when accessing shared
- * data structures such as the priority queue holding the data elements. Conditional
- * variables are used to notify the cleanup thread when new data is inserted,
- * allowing it to efficiently wait for new data without busy waiting.
+ * and retrieval of valid data. A cleanup thread removes expired data elements,
+ * sleeping until exactly the moment the oldest element expires. Mutexes are used
+ * to ensure thread safety when accessing shared data structures such as the storage
+ * holding the data elements. Conditional variables are used to notify the cleanup
+ * thread when data is inserted into an empty container, allowing it to efficiently
+ * wait for new data without busy waiting. Reads do not take the mutex though: the
+ * storage publishes an immutable table of its segments that readers traverse on
+ * their own, so readers never stall inserts however many of them there are.
+ *
+ * Alternatively a container can be given a shared ExpirationScheduler, in which case it
+ * starts no thread of its own and the scheduler sweeps it whenever its oldest element
+ * expires. This is the better choice when running many containers at once.
+ *
+ * Because every element lives for the same fixed duration, expiration order is
+ * exactly insertion order. The elements are therefore kept once, in a FIFO storage
+ * sorted by time, and removing expired data only ever pops from the front. Their
+ * insertion times are kept in arrays of their own next to the elements, and the
+ * expiration is not stored at all since it always lies the fixed duration later.
+ *
+ * With UnsynchronizedPolicy there is no cleanup thread and no locking at all, expired
+ * data is evicted lazily by insert and the accessors, or explicitly through tick().
+ * This is meant for single threaded code such as a game loop. With SpscPolicy the
+ * elements are kept in a lock-free ring shared by one producer, which only inserts,
+ * and one consumer, which does everything else including evicting expired data.
+ *
+ * Time comes from ClockType, any type meeting the standard Clock requirements, and
+ * every insert and read that needs the current time has an overload taking it, so
+ * callers can stamp many operations with a single clock read or drive simulated time.
+ * Insertion times must not go backwards, an insertion time earlier than the previous
+ * one is clamped to it to keep the storage sorted.
+ *
+ * With PerItemTtlPolicy every insert may give its element its own TTL, the fixed
+ * duration only being the default. Expiration order then differs from insertion order,
+ * so an ExpirationIndex next to the storage tracks which elements have expired and
+ * reads skip those that are still stored behind a longer lived one. This needs a
+ * policy that guards shared state, which SpscPolicy does not.
+ *
+ * Given a capacity the container never holds more than that many elements, expired
+ * or not, and preallocates the storage for them up front, so that with a fixed TTL a
+ * steady state insert never allocates as long as no snapshot is held across the
+ * recycling of its segments. What happens to an insert into a full container is
+ * chosen by an OverflowPolicy, inserts report whether they stored their element.
+ *
+ * Everything the container allocates, the storage segments, the expiration index and
+ * the vectors it returns, goes through Allocator rebound as needed. PoolAllocator
+ * recycles those blocks through a SlabPool so that a warmed up container stays off
+ * the heap entirely.
+ *
+ * Expired elements can be handed to an on_expire callback instead of being destroyed,
+ * for consumers that need to act on them. Consumers waiting for new data can co_await
+ * next_insert() or poll the descriptor of insert_events() instead of spinning on size().
+ *
+ * Aggregates, such as WindowAggregates<CountAggregate, SumAggregate<>, MinMaxAggregate<>>,
+ * are updated by every insert and removal, so window statistics are read through
+ * read_aggregates() in O(1) without copying the window. They cover every stored element,
+ * with PerItemTtlPolicy including the expired ones still stored behind a longer lived one.
+ *
+ * With StaticTtlPolicy the duration is a compile time constant, and RingPolicy keeps the
+ * elements in a ring whose capacity is one too, see StaticExpiringDataContainer.
+ *
+ * With Stats = ContainerStats the container counts what it does and times how long its
+ * mutex is waited for and held, read through stats(). The default NoStats compiles all
+ * of that away.
  */
-template <typename T> class ExpiringDataContainer {
+template <typename T, typename ConcurrencyPolicy = SynchronizedPolicy, typename ClockType = std::chrono::steady_clock,
+          typename ExpirationPolicy = FixedTtlPolicy, typename Allocator = std::allocator<T>,
+          typename Aggregates = NoAggregates, typename Stats = NoStats>
+class ExpiringDataContainer {
   public:
-    using Clock = std::chrono::steady_clock;
+    using Clock = ClockType;
     using TimePoint = std::chrono::time_point<Clock>;
     using Duration = std::chrono::milliseconds;
+    using Mutex = typename Stats::template Mutex<typename ConcurrencyPolicy::Mutex>;
 
-    struct TimedData {
-        T data;
-        TimePoint insertion;
-        TimePoint expiration;
+    /**
+     * @brief What is kept about every element besides the element itself, see FixedTtlPolicy and PerItemTtlPolicy.
+     *
+     * The storage keeps the stamps apart from the elements, so expiry and time range
+     * searches only ever touch densely packed timestamps.
+     */
+    using Stamp = typename ExpirationPolicy::template Stamp<TimePoint>;
 
-        bool operator>(const TimedData &other) const { return expiration > other.expiration; }
-    };
+    using Storage = typename ConcurrencyPolicy::template Storage<T, Stamp, Allocator>;
+    using Vector = std::vector<T, Allocator>;
+    using ExpireCallback = std::function<void(std::span<T> expired)>;
+
+    /**
+     * @brief A time ordered view of the elements, see TimeOrderedStorage::Snapshot and SpscRing::Snapshot.
+     *
+     * view[offset] is an element and view.stamp(offset) its Stamp.
+     */
+    using Snapshot = typename Storage::Snapshot;
+
+    /**
+     * @brief Whether the element stamped stamp in a snapshot taken as of now is still valid at now.
+     *
+     * Only elements with their own TTL can be stored behind a longer lived one, a snapshot
+     * never holds any other expired element.
+     */
+    static bool is_valid(const Stamp &stamp, TimePoint now);
+    /**
+     * @brief The offset of the first element of view inserted after time, view.size() if there is none.
+     *
+     * Insertions are monotonic, so this binary searches the stamps and scans the last few.
+     */
+    template <typename View> static std::size_t first_inserted_after(const View &view, TimePoint time);
 
-    explicit ExpiringDataContainer(Duration duration);
+    explicit ExpiringDataContainer(Duration duration, const Allocator &allocator = Allocator());
+    /**
+     * @brief Creates a container whose elements live for the TTL of its StaticTtlPolicy, only available with that.
+     *
+     * The constructors taking a duration throw std::invalid_argument for any other than it.
+     */
+    explicit ExpiringDataContainer(const Allocator &allocator = Allocator());
+    ExpiringDataContainer(std::size_t capacity, OverflowPolicy overflow, const Allocator &allocator = Allocator());
+    ExpiringDataContainer(Duration duration, ExpirationScheduler &scheduler, const Allocator &allocator = Allocator());
+
+    /**
+     * @brief Creates a container holding at most capacity elements, a capacity of 0 means unbounded.
+     *
+     * Throws std::invalid_argument for SpscPolicy, whose ring is bounded already. With
+     * RingPolicy a capacity of 0 means that of the ring, and a larger one than that throws.
+     */
+    ExpiringDataContainer(Duration duration, std::size_t capacity,
+                          OverflowPolicy overflow = OverflowPolicy::evict_oldest,
+                          const Allocator &allocator = Allocator());
+    ExpiringDataContainer(Duration duration, std::size_t capacity, OverflowPolicy overflow,
+                          ExpirationScheduler &scheduler, const Allocator &allocator = Allocator());
     ~ExpiringDataContainer();
 
-    void insert(const T &data);
-    std::vector<T> get_valid_data();
+    /**
+     * @brief Hands expired elements to callback in batches, oldest first, for it to move from.
+     *
+     * With background cleanup the callback runs on the cleanup thread or the scheduler
+     * thread, otherwise at the end of the operation that removed the elements, and never
+     * with the lock held. Elements evicted to make room in a bounded container are handed
+     * over too, those still stored when the container is destroyed are not. Set the
+     * callback before the container is shared between threads.
+     */
+    void on_expire(ExpireCallback callback);
+
+    bool insert(const T &data);
+    bool insert(T &&data);
+    bool insert(const T &data, TimePoint now);
+    bool insert(T &&data, TimePoint now);
+
+    /**
+     * @brief Constructs an element from args directly in its storage slot.
+     */
+    template <typename... Args> bool emplace(Args &&...args);
+    template <typename... Args> bool emplace_at(TimePoint now, Args &&...args);
+
+    /**
+     * @brief Inserts an element that expires ttl after its insertion instead of after the fixed duration.
+     *
+     * Only available with PerItemTtlPolicy.
+     */
+    bool insert(const T &data, Duration ttl);
+    bool insert(T &&data, Duration ttl);
+    bool insert(const T &data, Duration ttl, TimePoint now);
+    bool insert(T &&data, Duration ttl, TimePoint now);
+    template <typename... Args> bool emplace_for(Duration ttl, Args &&...args);
+
+    /**
+     * @brief Inserts every element of [first, last) under a single lock acquisition.
+     *
+     * All elements share one insertion time and the cleanup thread is woken at most once.
+     * Pass move iterators to move the elements in. Returns how many elements were inserted,
+     * which is less than all of them only when a full container rejects the rest.
+     */
+    template <typename InputIt> std::size_t insert_batch(InputIt first, InputIt last);
+    template <typename InputIt> std::size_t insert_batch(InputIt first, InputIt last, TimePoint now);
+    std::size_t insert_batch(std::span<const T> batch);
+    std::size_t insert_batch(std::span<const T> batch, TimePoint now);
+
+    Vector get_valid_data();
+    Vector get_valid_data(TimePoint now);
+
+    /**
+     * @brief Moves every valid element to the back of out, oldest first, and removes them.
+     *
+     * Elements that an outstanding snapshot still references are copied instead of moved.
+     * With a fixed TTL and a storage that grows, every element left after removing the
+     * expired ones is valid, so the whole storage is handed over under the lock in O(1)
+     * and its elements are moved to out after the lock has been released.
+     */
+    void drain_valid(Vector &out);
+
+    // takes every valid element, oldest first, leaving the container empty, see drain_valid()
+    Vector drain_all();
+    Vector drain_all(TimePoint now);
+
+    /**
+     * @brief Takes the valid elements inserted no later than time, oldest first, and removes them.
+     *
+     * The elements inserted after time stay, so this drains the complement of
+     * get_data_exceeding(time). Unless that takes every element the lock is held while
+     * the elements are moved out.
+     */
+    Vector drain_older_than(TimePoint time);
+
+    /**
+     * @brief Replaces the contents of out with every valid element, for handing buffers back and forth.
+     *
+     * A consumer passing the same vector every time reuses its capacity, so with two of
+     * them a producer and a consumer double buffer without allocating, see drain_valid().
+     */
+    void swap_out(Vector &out);
+
+    /**
+     * @brief Removes expired data and returns a view of what is left, oldest first.
+     *
+     * The lock is only held while the view is taken, which does not copy any elements, so
+     * traversing the view never blocks inserts or the cleanup thread. With lock free reads
+     * the lock is not taken at all, the view skips whatever the cleanup has not removed yet.
+     */
+    Snapshot snapshot();
+    Snapshot snapshot(TimePoint now);
+
+    /**
+     * @brief Calls visitor with every valid element, oldest first, without holding the lock.
+     */
+    template <typename Visitor> void for_each_valid(Visitor &&visitor);
+
     bool is_less_than_all(TimePoint time) const;
-    std::vector<T> get_data_exceeding(TimePoint time);
+    Vector get_data_exceeding(TimePoint time);
+
+    /**
+     * @brief Returns the valid data inserted after from and no later than to, oldest first.
+     *
+     * Consecutive calls with adjacent ranges never return the same element twice, and
+     * get_data_between(time, Clock::now()) matches get_data_exceeding(time).
+     */
+    Vector get_data_between(TimePoint from, TimePoint to);
+
+    /**
+     * @brief Counts the elements get_data_between(from, to) would return without copying any of them.
+     *
+     * With a fixed TTL this is two binary searches, with per item TTLs the expirations in
+     * between are counted by a vectorized scan.
+     */
+    std::size_t count_between(TimePoint from, TimePoint to);
+
+    /**
+     * @brief Calls visitor with every valid element inserted after time, oldest first.
+     */
+    template <typename Visitor> void for_each_exceeding(TimePoint time, Visitor &&visitor);
+
+    /**
+     * @brief A position in insertion order, for reading only what was inserted since the previous read.
+     *
+     * Every element has a sequence number counted from the first insert, so a cursor
+     * finds its position again in O(1) and a read costs O(new elements), without ever
+     * returning an element twice. Cursors are independent of each other and must not
+     * outlive their container.
+     */
+    class Cursor {
+      public:
+        /**
+         * @brief Appends the valid elements inserted since the previous call to out, oldest first.
+         *
+         * Returns how many were appended. If the elements at the cursor's position have
+         * been removed in the meantime the cursor moves on to the oldest one left.
+         */
+        std::size_t next_batch(Vector &out);
+        std::size_t next_batch(Vector &out, TimePoint now);
+
+        // how many elements expired or were evicted before the cursor reached them
+        std::uint64_t missed() const { return missed_count; }
+
+      private:
+        friend class ExpiringDataContainer;
+
+        Cursor(ExpiringDataContainer *container, std::uint64_t position) : container(container), position(position) {}
+
+        ExpiringDataContainer *container;
+        std::uint64_t position; // sequence number of the next element to read
+        std::uint64_t missed_count = 0;
+    };
+
+    // a cursor whose first batch holds every valid element
+    Cursor cursor();
+    // a cursor that only sees the elements inserted after it was created
+    Cursor cursor_at_end();
+
+    /**
+     * @brief What co_await container.next_insert() suspends on until an element is inserted.
+     *
+     * The coroutine is not suspended at all if an element has been inserted since
+     * next_insert() was called.
+     */
+    class InsertAwaiter {
+      public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+      private:
+        friend class ExpiringDataContainer;
+
+        InsertAwaiter(ExpiringDataContainer *container, std::uint64_t sequence)
+            : container(container), sequence(sequence) {}
+
+        ExpiringDataContainer *container;
+        std::uint64_t sequence; // the sequence number the awaited element gets
+    };
+
+    /**
+     * @brief What co_await container.wait_until_empty() suspends on until no element is stored.
+     */
+    class EmptyAwaiter {
+      public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+      private:
+        friend class ExpiringDataContainer;
+
+        explicit EmptyAwaiter(ExpiringDataContainer *container) : container(container) {}
+
+        ExpiringDataContainer *container;
+    };
+
+    /**
+     * @brief Lets a coroutine co_await the next insert instead of polling for it.
+     *
+     * Waiting coroutines are resumed by the thread whose operation released them, the
+     * inserting thread here, once it has released the lock. They may use the container
+     * but must not destroy it, and a container must not be destroyed while coroutines
+     * wait on it. Not available with SpscPolicy.
+     */
+    InsertAwaiter next_insert();
+
+    /**
+     * @brief Lets a coroutine co_await the moment no element is stored anymore, right away if none is.
+     *
+     * The coroutine is resumed by whichever removes the last element, usually the cleanup
+     * thread or the scheduler, see next_insert(). With PerItemTtlPolicy an expired
+     * element stored behind a longer lived one keeps the container from being empty.
+     */
+    EmptyAwaiter wait_until_empty();
+
+    /**
+     * @brief Returns a notifier that every insert from now on signals, to wait for inserts in an event loop.
+     *
+     * Register fd() with epoll or io_uring and call consume() once it turns readable,
+     * before reading the new elements, for instance through a Cursor. Not available with
+     * SpscPolicy.
+     */
+    EventNotifier &insert_events();
+
+    /**
+     * @brief Removes expired data and returns what reader computes from the aggregates, under the lock.
+     *
+     * reader is called with a const Aggregates&, for instance
+     * read_aggregates([](const auto &window) { return window.template get<SumAggregate<>>().mean(); }).
+     */
+    template <typename Reader> auto read_aggregates(Reader &&reader);
+    template <typename Reader> auto read_aggregates(Reader &&reader, TimePoint now);
+
+    /**
+     * @brief Appends every stored element to out in a compact binary format, for restore_from after a restart.
+     *
+     * Times are written relative to now, see snapshot_io, so restored elements keep the
+     * lifetime they had left. The elements are copied as bytes, a memcpy per storage
+     * segment, and the lock is only held while the view is taken. Only available for
+     * trivially copyable T.
+     */
+    void snapshot_to(std::vector<std::byte> &out);
+    void snapshot_to(std::vector<std::byte> &out, TimePoint now);
+
+    /**
+     * @brief Writes the same format to fd from its current offset, the elements straight from their segments.
+     *
+     * The whole snapshot goes out in one writev per IOV_MAX pieces, throws std::system_error
+     * when writing fails.
+     */
+    void snapshot_to(int fd);
+    void snapshot_to(int fd, TimePoint now);
+
+    /**
+     * @brief Inserts the elements of a snapshot with the lifetime they had left when it was taken, returns how many.
+     *
+     * Elements with no lifetime left are skipped, and like insert_batch the elements are
+     * inserted under a single lock acquisition, subject to the capacity. They go behind
+     * the elements stored already, insertion times clamped to theirs. Throws
+     * std::invalid_argument for data that is no snapshot of elements of this size.
+     *
+     * Without per item TTLs every element lives for the container's duration from its
+     * insertion, and the remainders of a snapshot taken with them are ignored. With per
+     * item TTLs the remainders are kept, a snapshot without them gets the duration.
+     */
+    std::size_t restore_from(std::span<const std::byte> data);
+    std::size_t restore_from(std::span<const std::byte> data, TimePoint now);
+    // reads the snapshot from fd's current offset, throws std::system_error when reading fails
+    std::size_t restore_from(int fd);
+    std::size_t restore_from(int fd, TimePoint now);
+
     void print_state() const;
+    /**
+     * @brief The number of elements still valid now, whether or not a cleanup has run since the others expired.
+     *
+     * With per item TTLs this scans the expiration of every stored element.
+     */
     size_t size() const;
     T get_most_recent() const;
 
+    /**
+     * @brief The number of stored elements, read without locking.
+     *
+     * This counts expired elements that have not been removed yet, and with concurrent
+     * inserts or removals it may be slightly out of date.
+     */
+    std::size_t approximate_size() const;
+
+    /**
+     * @brief Returns a copy of the most recently inserted valid element, or nullopt if there is none.
+     *
+     * Never throws, and with a policy that has lock free reads never locks either.
+     */
+    std::optional<T> try_get_most_recent() const;
+
+    /**
+     * @brief Removes the data that has expired as of now.
+     *
+     * Containers without background cleanup rely on this or on their other operations to
+     * evict expired data, for the others it only makes the eviction happen sooner.
+     */
+    void tick(TimePoint now = Clock::now());
+
+    /**
+     * @brief The counters and histograms kept so far, only available with ContainerStats.
+     *
+     * Reading them never takes the lock, so a metrics exporter can scrape them at any rate.
+     */
+    typename Stats::Snapshot stats() const;
+
   private:
-    std::priority_queue<TimedData, std::vector<TimedData>, std::greater<>> pq;
-    std::deque<TimedData> insertion_order;
+    [[no_unique_address]] Allocator allocator;
+    Storage storage;
     Duration fixed_duration;
+    std::size_t capacity = 0; // 0 when unbounded
+    OverflowPolicy overflow = OverflowPolicy::evict_oldest;
+    TimePoint last_insertion{}; // only touched by inserts, so it is safe for SpscPolicy's producer
     std::thread cleanup_thread;
-    mutable std::mutex mtx; // Mutable mutex for use in const member functions
-    std::condition_variable cv;
+    mutable Mutex mtx; // Mutable mutex for use in const member functions
+    using ConditionVariable =
+        std::conditional_t<std::is_same_v<Mutex, std::mutex>, std::condition_variable, std::condition_variable_any>;
+    ConditionVariable cv;
     bool stop_cleanup = false;
+    ExpirationScheduler *scheduler = nullptr; // replaces cleanup_thread when set
+    ExpirationScheduler::RegistrationId registration = 0;
+    TimePoint wake_deadline = TimePoint::max(); // when the cleanup is due next, max when nothing is pending
+    [[no_unique_address]] typename ExpirationPolicy::template Index<
+        Clock, typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint64_t>>
+        index;
+    ConditionVariable space_available; // wakes inserts blocked on a full container
+    std::size_t blocked_inserts = 0;
+    ExpireCallback expire_callback;
+    Vector expired_batch; // removed but not handed to expire_callback yet
+    Vector delivering;    // the batch expire_callback is working on, kept to reuse its buffer
+    bool delivering_expired = false;
+    std::uint64_t popped = 0; // elements ever removed from the front, the sequence number of the front
+    [[no_unique_address]] Aggregates aggregates;
+    struct InsertWaiter {
+        std::coroutine_handle<> handle;
+        std::uint64_t sequence;
+    };
+    std::vector<InsertWaiter> insert_waiters;
+    std::vector<std::coroutine_handle<>> empty_waiters;
+    std::unique_ptr<EventNotifier> insert_notifier; // created by the first insert_events()
+    std::uint64_t notified_sequence = 0;            // the sequence number insert_notifier last signaled
+    [[no_unique_address]] mutable Stats counters;
 
     void cleanup_expired_data();
-    void remove_expired(TimePoint now);
+    std::size_t remove_expired(TimePoint now); // returns how many elements it removed
+    void drain_until(TimePoint time, TimePoint now, Vector &out);
+    void sweep_expired(TimePoint now); // remove_expired for the cleanup thread and the scheduler, counted as a sweep
+    void evict_lazily(TimePoint now);
+    std::size_t first_unexpired() const;
+    std::optional<TimePoint> next_expiration() const;
+    bool brings_deadline_forward(TimePoint expiration);
+    void wake_cleanup(TimePoint expiration);
+    std::optional<TimePoint> sweep(TimePoint now);
+    template <typename... Args> bool emplace_with(Duration ttl, TimePoint now, Args &&...args);
+    template <typename... Args> void append(TimePoint insertion, TimePoint expiration, Args &&...args);
+    bool make_room(std::unique_lock<Mutex> &lock, TimePoint &now);
+    void pop_oldest();
+    std::size_t read_since(Cursor &cursor, Vector &out, TimePoint now);
+    void hand_over_expired(std::unique_lock<Mutex> &lock);
+    void finish_removal(std::unique_lock<Mutex> &lock);
+    void finish_insert(std::unique_lock<Mutex> &lock);
+    void resume_waiters(std::unique_lock<Mutex> &lock);
+    void notify_space();
+    const T *newest_valid(TimePoint now) const;
+    Snapshot published_view(TimePoint now) const;
+    void reserve_capacity();
+    void check_static_ttl() const;
+
+    // with StaticTtlPolicy a constant, which the compiler folds into every expiration computed from it
+    Duration fixed_ttl() const {
+        if constexpr (ExpirationPolicy::static_ttl) {
+            return ExpirationPolicy::ttl;
+        } else {
+            return fixed_duration;
+        }
+    }
+    static constexpr Duration static_duration() {
+        static_assert(ExpirationPolicy::static_ttl, "only StaticTtlPolicy fixes the duration at compile time");
+        return ExpirationPolicy::ttl;
+    }
+
+    static Stamp make_stamp(TimePoint insertion, TimePoint expiration);
+    TimePoint expiration_of(const Stamp &stamp) const;
+
+    // whether the stamps can be handed to the timestamp_scan kernels as plain 64 bit tick counts
+    static constexpr bool scannable_stamps = std::is_integral_v<typename TimePoint::rep> &&
+                                             std::is_signed_v<typename TimePoint::rep> &&
+                                             sizeof(TimePoint) == sizeof(std::int64_t) &&
+                                             sizeof(Stamp) % sizeof(std::int64_t) == 0;
+    // whether drains can hand the whole storage over, which needs every element it holds to be valid
+    static constexpr bool hands_over_storage = !ExpirationPolicy::per_item_ttl && ConcurrencyPolicy::ring_capacity == 0;
+    // the binary searches leave ranges of at most this many elements to a vectorized scan
+    static constexpr std::size_t scan_threshold = 64;
+
+    // the offset of the first element from first on whose Field is later than limit, view.size() if none
+    template <auto Field, typename View> static std::size_t first_later(const View &view, std::size_t first,
+                                                                        TimePoint limit);
+    // how many elements in [first, last) have a Field later than limit
+    template <auto Field, typename View> static std::size_t count_later(const View &view, std::size_t first,
+                                                                        std::size_t last, TimePoint limit);
+    template <auto Field> static std::size_t field_word(std::span<const Stamp> run);
+
+    Vector collect(const Snapshot &snapshot, std::size_t first, std::size_t last, TimePoint now) const;
+
+    // the header and the times of a snapshot of view taken at now, see snapshot_io
+    snapshot_io::Header snapshot_header(const Snapshot &view) const;
+    std::vector<std::int64_t> snapshot_times(const Snapshot &view, TimePoint now) const;
 };
 
+/**
+ * @brief A single threaded container whose TTL and capacity are both fixed at compile time.
+ *
+ * The expiry arithmetic folds the constant TTL, the elements live in a power of two ring
+ * indexed by a mask, and only their insertion times are stored. Once full the oldest
+ * element is evicted to make room, unless another OverflowPolicy is given. The runtime
+ * configured ExpiringDataContainer remains for everything else.
+ */
+template <typename T, std::int64_t TtlMilliseconds, std::size_t Capacity = 4096,
+          typename ClockType = std::chrono::steady_clock>
+using StaticExpiringDataContainer =
+    ExpiringDataContainer<T, RingPolicy<Capacity>, ClockType, StaticTtlPolicy<TtlMilliseconds>>;
+
 #include "expiring_data_container.tpp"
 
 #endif // EXPIRING_DATA_CONTAINER_HPP
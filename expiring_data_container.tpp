@@ -1,129 +1,1368 @@
 #include "expiring_data_container.hpp"
 
-template <typename T>
-ExpiringDataContainer<T>::ExpiringDataContainer(Duration duration) : fixed_duration(duration) {
-    cleanup_thread = std::thread(&ExpiringDataContainer::cleanup_expired_data, this);
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::ExpiringDataContainer(const Allocator &allocator)
+    : ExpiringDataContainer(static_duration(), 0, OverflowPolicy::evict_oldest, allocator) {}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::ExpiringDataContainer(std::size_t capacity, OverflowPolicy overflow,
+                                                                const Allocator &allocator)
+    : ExpiringDataContainer(static_duration(), capacity, overflow, allocator) {}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::ExpiringDataContainer(Duration duration, const Allocator &allocator)
+    : ExpiringDataContainer(duration, 0, OverflowPolicy::evict_oldest, allocator) {}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::ExpiringDataContainer(
+    Duration duration, std::size_t capacity, OverflowPolicy overflow, const Allocator &allocator)
+    : allocator(allocator), storage(allocator), fixed_duration(duration), capacity(capacity), overflow(overflow),
+      index(allocator), expired_batch(allocator), delivering(allocator) {
+    check_static_ttl();
+    reserve_capacity();
+    static_assert(!ExpirationPolicy::per_item_ttl || ConcurrencyPolicy::guards_shared_state,
+                  "the expiration index is written by inserts and evictions alike");
+    static_assert(std::is_same_v<Aggregates, NoAggregates> || ConcurrencyPolicy::guards_shared_state,
+                  "the aggregates are written by inserts and evictions alike");
+    static_assert(!Stats::enabled || ConcurrencyPolicy::guards_shared_state,
+                  "the instrumented mutex times the lock it is taken under, an unguarded policy has none");
+    if constexpr (Stats::enabled) {
+        mtx.attach(counters);
+    }
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        cleanup_thread = std::thread(&ExpiringDataContainer::cleanup_expired_data, this);
+    }
 }
 
-template <typename T>
-ExpiringDataContainer<T>::~ExpiringDataContainer() {
-    {
-        std::lock_guard<std::mutex> lock(mtx);
-        stop_cleanup = true;
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::ExpiringDataContainer(
+    Duration duration, ExpirationScheduler &scheduler, const Allocator &allocator)
+    : ExpiringDataContainer(duration, 0, OverflowPolicy::evict_oldest, scheduler, allocator) {}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::ExpiringDataContainer(
+    Duration duration, std::size_t capacity, OverflowPolicy overflow, ExpirationScheduler &scheduler,
+    const Allocator &allocator)
+    : allocator(allocator), storage(allocator), fixed_duration(duration), capacity(capacity), overflow(overflow),
+      scheduler(&scheduler), index(allocator), expired_batch(allocator), delivering(allocator) {
+    check_static_ttl();
+    reserve_capacity();
+    static_assert(ConcurrencyPolicy::background_cleanup, "the scheduler sweeps from its own thread, which needs a "
+                                                         "synchronized container");
+    static_assert(std::is_same_v<Clock, ExpirationScheduler::Clock>, "the scheduler only keeps steady_clock time");
+    if constexpr (Stats::enabled) {
+        mtx.attach(counters);
     }
-    cv.notify_all();
-    cleanup_thread.join();
+    registration = scheduler.add([this](TimePoint now) { return sweep(now); });
 }
 
-template <typename T>
-void ExpiringDataContainer<T>::insert(const T& data) {
-    TimePoint now = Clock::now();
-    TimePoint expiration = now + fixed_duration;
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::~ExpiringDataContainer() {
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        if (scheduler) {
+            scheduler->remove(registration);
+            return;
+        }
+        {
+            std::lock_guard<Mutex> lock(mtx);
+            stop_cleanup = true;
+        }
+        cv.notify_all();
+        cleanup_thread.join();
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::on_expire(
+    ExpireCallback callback) {
+    std::lock_guard<Mutex> lock(mtx);
+    expire_callback = std::move(callback);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert(
+    const T& data) {
+    return emplace_at(Clock::now(), data);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::insert(T &&data) {
+    return emplace_at(Clock::now(), std::move(data));
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert(
+    const T &data, TimePoint now) {
+    return emplace_at(now, data);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert(
+    T &&data, TimePoint now) {
+    return emplace_at(now, std::move(data));
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert(
+    const T &data, Duration ttl) {
+    return emplace_for(ttl, data);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert(
+    T &&data, Duration ttl) {
+    return emplace_for(ttl, std::move(data));
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert(
+    const T &data, Duration ttl, TimePoint now) {
+    static_assert(ExpirationPolicy::per_item_ttl, "per item TTLs need PerItemTtlPolicy");
+    return emplace_with(ttl, now, data);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert(
+    T &&data, Duration ttl, TimePoint now) {
+    static_assert(ExpirationPolicy::per_item_ttl, "per item TTLs need PerItemTtlPolicy");
+    return emplace_with(ttl, now, std::move(data));
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename... Args>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::emplace(
+    Args &&...args) {
+    return emplace_at(Clock::now(), std::forward<Args>(args)...);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename... Args>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::emplace_at(
+    TimePoint now, Args &&...args) {
+    return emplace_with(fixed_ttl(), now, std::forward<Args>(args)...);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename... Args>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::emplace_for(Duration ttl, Args &&...args) {
+    static_assert(ExpirationPolicy::per_item_ttl, "per item TTLs need PerItemTtlPolicy");
+    return emplace_with(ttl, Clock::now(), std::forward<Args>(args)...);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename... Args>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::emplace_with(Duration ttl, TimePoint now, Args &&...args) {
+    TimePoint expiration;
+    bool wake;
     {
-        std::lock_guard<std::mutex> lock(mtx);
-        TimedData timed_data = {data, now, expiration};
-        pq.push(timed_data);
-        insertion_order.push_back(timed_data);
+        std::unique_lock<Mutex> lock(mtx);
+        evict_lazily(now);
+        if (!make_room(lock, now)) {
+            return false;
+        }
+        now = std::max(now, last_insertion);
+        last_insertion = now;
+        expiration = now + ttl;
+        append(now, expiration, std::forward<Args>(args)...);
+        wake = brings_deadline_forward(expiration);
+        finish_insert(lock);
+    }
+    if (wake) {
+        wake_cleanup(expiration);
     }
-    cv.notify_all();
+    return true;
 }
 
-template <typename T>
-std::vector<T> ExpiringDataContainer<T>::get_valid_data() {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto now = Clock::now();
-    remove_expired(now);
-    std::vector<T> valid_data;
-    std::priority_queue<TimedData, std::vector<TimedData>, std::greater<>> temp_pq = pq;
-    while (!temp_pq.empty()) {
-        valid_data.push_back(temp_pq.top().data);
-        temp_pq.pop();
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename... Args>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::append(
+    TimePoint insertion, TimePoint expiration, Args &&...args) {
+    aggregates.on_insert(storage.emplace_back(make_stamp(insertion, expiration), std::forward<Args>(args)...));
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        index.on_insert(expiration);
     }
-    return valid_data;
+    counters.on_insert(storage.size());
 }
 
-template <typename T>
-bool ExpiringDataContainer<T>::is_less_than_all(TimePoint time) const {
-    std::lock_guard<std::mutex> lock(mtx);
-    std::priority_queue<TimedData, std::vector<TimedData>, std::greater<>> temp_pq = pq;
-    while (!temp_pq.empty()) {
-        if (temp_pq.top().insertion <= time) {
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::make_room(
+    std::unique_lock<Mutex> &lock, TimePoint &now) {
+    if (capacity == 0 || storage.size() < capacity) {
+        return true;
+    }
+    remove_expired(now);
+    while (storage.size() >= capacity) {
+        switch (overflow) {
+        case OverflowPolicy::evict_oldest:
+            pop_oldest();
+            counters.on_evict();
+            break;
+        case OverflowPolicy::reject:
+            counters.on_reject();
             return false;
+        case OverflowPolicy::block:
+            // whoever removes data next wakes us up, otherwise expiring it is up to us
+            ++blocked_inserts;
+            if (std::optional<TimePoint> deadline = next_expiration()) {
+                space_available.wait_until(lock, *deadline);
+            } else {
+                space_available.wait(lock);
+            }
+            --blocked_inserts;
+            now = std::max(now, Clock::now());
+            remove_expired(now);
+            break;
+        }
+    }
+    return true;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::get_valid_data() {
+    return get_valid_data(Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::get_valid_data(
+    TimePoint now) {
+    Snapshot valid = snapshot(now);
+    return collect(valid, 0, valid.size(), now);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename InputIt>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert_batch(
+    InputIt first, InputIt last) {
+    return insert_batch(first, last, Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename InputIt>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert_batch(
+    InputIt first, InputIt last, TimePoint now) {
+    std::size_t inserted = 0;
+    TimePoint first_expiration;
+    bool wake = false;
+    {
+        std::unique_lock<Mutex> lock(mtx);
+        evict_lazily(now);
+        if constexpr (std::forward_iterator<InputIt>) {
+            // a bounded storage has preallocated its segments already
+            if (capacity == 0) {
+                storage.reserve_back(static_cast<std::size_t>(std::distance(first, last)));
+            }
+        }
+        for (; first != last; ++first) {
+            if (!make_room(lock, now)) {
+                break;
+            }
+            // unless make_room had to wait this is the same time for the whole batch
+            now = std::max(now, last_insertion);
+            last_insertion = now;
+            TimePoint expiration = now + fixed_ttl();
+            append(now, expiration, *first);
+            if (inserted++ == 0) {
+                first_expiration = expiration;
+            }
+        }
+        wake = inserted > 0 && brings_deadline_forward(first_expiration);
+        finish_insert(lock);
+    }
+    if (wake) {
+        wake_cleanup(first_expiration);
+    }
+    return inserted;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert_batch(
+    std::span<const T> batch) {
+    return insert_batch(batch.begin(), batch.end(), Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::insert_batch(
+    std::span<const T> batch, TimePoint now) {
+    return insert_batch(batch.begin(), batch.end(), now);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::drain_valid(Vector &out) {
+    drain_until(TimePoint::max(), Clock::now(), out);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::drain_all() {
+    return drain_all(Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::drain_all(
+    TimePoint now) {
+    Vector drained(allocator);
+    drain_until(TimePoint::max(), now, drained);
+    return drained;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::drain_older_than(TimePoint time) {
+    Vector drained(allocator);
+    drain_until(time, Clock::now(), drained);
+    return drained;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::swap_out(Vector &out) {
+    out.clear();
+    drain_until(TimePoint::max(), Clock::now(), out);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::drain_until(TimePoint time, TimePoint now, Vector &out) {
+    std::optional<Storage> handed_over;
+    {
+        std::unique_lock<Mutex> lock(mtx);
+        remove_expired(now);
+        std::size_t drained = first_inserted_after(storage, time);
+        popped += drained;
+        if constexpr (hands_over_storage) {
+            if (drained == storage.size() && drained > 0) {
+                handed_over.emplace(allocator);
+                storage.move_all_into(*handed_over);
+                aggregates = Aggregates();
+                drained = 0;
+            }
+        }
+        out.reserve(out.size() + drained);
+        storage.pop_front_into(drained, [this, &out, now](const Stamp &stamp, auto &&data) {
+            aggregates.on_remove(data);
+            if (is_valid(stamp, now)) {
+                out.push_back(std::forward<decltype(data)>(data));
+            } else if (expire_callback) {
+                expired_batch.push_back(std::forward<decltype(data)>(data));
+            }
+            if constexpr (ExpirationPolicy::per_item_ttl) {
+                index.on_pop_front();
+            }
+        });
+        notify_space();
+        finish_removal(lock);
+    }
+    if constexpr (hands_over_storage) {
+        if (handed_over) {
+            out.reserve(out.size() + handed_over->size());
+            handed_over->pop_all_into([&out](const Stamp &, auto &&data) {
+                out.push_back(std::forward<decltype(data)>(data));
+            });
+        }
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                               Aggregates, Stats>::Snapshot
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::snapshot() {
+    return snapshot(Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                               Aggregates, Stats>::Snapshot
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::snapshot(
+    TimePoint now) {
+    counters.on_query();
+    if constexpr (ConcurrencyPolicy::lock_free_reads) {
+        return published_view(now);
+    } else {
+        std::unique_lock<Mutex> lock(mtx);
+        remove_expired(now);
+        Snapshot current = storage.snapshot();
+        finish_removal(lock);
+        return current;
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                               Aggregates, Stats>::Snapshot
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::published_view(
+    TimePoint now) const {
+    Snapshot current = storage.published_snapshot();
+    // the cleanup may be running late, its work is left to it and the expired front only skipped here
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        current.remove_prefix(first_later<&Stamp::expiration>(current, 0, now));
+    } else {
+        current.remove_prefix(first_inserted_after(current, now - fixed_ttl()));
+    }
+    return current;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename Visitor>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::for_each_valid(Visitor &&visitor) {
+    TimePoint now = Clock::now();
+    Snapshot valid = snapshot(now);
+    for (std::size_t offset = 0; offset < valid.size(); ++offset) {
+        if (is_valid(valid.stamp(offset), now)) {
+            visitor(valid[offset]);
+        }
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::is_less_than_all(TimePoint time) const {
+    // the oldest element has the smallest insertion time
+    if constexpr (ConcurrencyPolicy::lock_free_reads) {
+        Snapshot valid = published_view(Clock::now());
+        return valid.empty() || valid.stamp(0).insertion > time;
+    } else {
+        std::lock_guard<Mutex> lock(mtx);
+        std::size_t oldest = first_unexpired();
+        return oldest == storage.size() || storage.stamp(oldest).insertion > time;
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::get_data_exceeding(TimePoint time) {
+    TimePoint now = Clock::now();
+    Snapshot valid = snapshot(now);
+    return collect(valid, first_inserted_after(valid, time), valid.size(), now);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::get_data_between(TimePoint from, TimePoint to) {
+    TimePoint now = Clock::now();
+    Snapshot valid = snapshot(now);
+    std::size_t first = first_inserted_after(valid, from);
+    std::size_t last = first_inserted_after(valid, to);
+    return collect(valid, first, std::max(first, last), now);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::count_between(
+    TimePoint from, TimePoint to) {
+    TimePoint now = Clock::now();
+    Snapshot valid = snapshot(now);
+    std::size_t first = first_inserted_after(valid, from);
+    std::size_t last = std::max(first, first_inserted_after(valid, to));
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        return count_later<&Stamp::expiration>(valid, first, last, now);
+    } else {
+        return last - first;
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename Visitor>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::for_each_exceeding(TimePoint time, Visitor &&visitor) {
+    TimePoint now = Clock::now();
+    Snapshot valid = snapshot(now);
+    for (std::size_t offset = first_inserted_after(valid, time); offset < valid.size(); ++offset) {
+        if (is_valid(valid.stamp(offset), now)) {
+            visitor(valid[offset]);
         }
-        temp_pq.pop();
     }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Cursor
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::cursor() {
+    std::lock_guard<Mutex> lock(mtx);
+    return Cursor(this, popped);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Cursor
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::cursor_at_end() {
+    std::lock_guard<Mutex> lock(mtx);
+    return Cursor(this, popped + storage.size());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::Cursor::next_batch(Vector &out) {
+    return next_batch(out, Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::Cursor::next_batch(Vector &out, TimePoint now) {
+    return container->read_since(*this, out, now);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                               Aggregates, Stats>::InsertAwaiter
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::next_insert() {
+    static_assert(ConcurrencyPolicy::guards_shared_state, "the waiters are shared by the producer and the consumer");
+    std::lock_guard<Mutex> lock(mtx);
+    return InsertAwaiter(this, popped + storage.size());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                               Aggregates, Stats>::EmptyAwaiter
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::wait_until_empty() {
+    static_assert(ConcurrencyPolicy::guards_shared_state, "the waiters are shared by the producer and the consumer");
+    return EmptyAwaiter(this);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::InsertAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    std::lock_guard<Mutex> lock(container->mtx);
+    if (container->popped + container->storage.size() > sequence) {
+        return false;
+    }
+    container->insert_waiters.push_back(InsertWaiter{handle, sequence});
     return true;
 }
 
-template <typename T>
-std::vector<T> ExpiringDataContainer<T>::get_data_exceeding(TimePoint time) {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto now = Clock::now();
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::EmptyAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    std::lock_guard<Mutex> lock(container->mtx);
+    if (container->storage.empty()) {
+        return false;
+    }
+    container->empty_waiters.push_back(handle);
+    return true;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+EventNotifier &
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::insert_events() {
+    static_assert(ConcurrencyPolicy::guards_shared_state, "the notifier is shared by the producer and the consumer");
+    std::lock_guard<Mutex> lock(mtx);
+    if (!insert_notifier) {
+        insert_notifier = std::make_unique<EventNotifier>();
+        notified_sequence = popped + storage.size();
+    }
+    return *insert_notifier;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::read_since(Cursor &cursor, Vector &out, TimePoint now) {
+    counters.on_query();
+    std::unique_lock<Mutex> lock(mtx);
     remove_expired(now);
-    std::vector<T> exceeding_data;
-    std::priority_queue<TimedData, std::vector<TimedData>, std::greater<>> temp_pq = pq;
-    while (!temp_pq.empty()) {
-        if (temp_pq.top().insertion > time) {
-            exceeding_data.push_back(temp_pq.top().data);
+    if (cursor.position < popped) {
+        // the cursor's position has been removed already, resume at the oldest element left
+        cursor.missed_count += popped - cursor.position;
+        cursor.position = popped;
+    }
+    std::size_t appended = 0;
+    for (std::size_t offset = cursor.position - popped; offset < storage.size(); ++offset) {
+        if (is_valid(storage.stamp(offset), now)) {
+            out.push_back(storage[offset]);
+            ++appended;
+        } else {
+            ++cursor.missed_count;
+        }
+    }
+    cursor.position = popped + storage.size();
+    finish_removal(lock);
+    return appended;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename View>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::first_inserted_after(const View &view, TimePoint time) {
+    // halving a short range costs more in mispredicted branches than scanning it
+    std::size_t low = 0, high = view.size();
+    while (high - low > scan_threshold) {
+        std::size_t middle = low + (high - low) / 2;
+        if (view.stamp(middle).insertion <= time) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
-        temp_pq.pop();
     }
-    return exceeding_data;
+    return first_later<&Stamp::insertion>(view, low, time);
 }
 
-template <typename T>
-void ExpiringDataContainer<T>::print_state() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    std::priority_queue<TimedData, std::vector<TimedData>, std::greater<>> temp_pq = pq;
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <auto Field, typename View>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::first_later(
+    const View &view, std::size_t first, TimePoint limit) {
+    while (first < view.size()) {
+        std::span<const Stamp> run = view.stamp_run(first);
+        std::size_t found;
+        if constexpr (scannable_stamps) {
+            found = timestamp_scan::find_first_greater(reinterpret_cast<const std::int64_t *>(run.data()), run.size(),
+                                                       sizeof(Stamp) / sizeof(std::int64_t), field_word<Field>(run),
+                                                       limit.time_since_epoch().count());
+        } else {
+            found = std::find_if(run.begin(), run.end(), [limit](const Stamp &stamp) { return stamp.*Field > limit; }) -
+                    run.begin();
+        }
+        first += found;
+        if (found < run.size()) {
+            break;
+        }
+    }
+    return first;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <auto Field, typename View>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::count_later(
+    const View &view, std::size_t first, std::size_t last, TimePoint limit) {
+    std::size_t count = 0;
+    while (first < last) {
+        std::span<const Stamp> run = view.stamp_run(first);
+        run = run.first(std::min(run.size(), last - first));
+        if constexpr (scannable_stamps) {
+            count += timestamp_scan::count_greater(reinterpret_cast<const std::int64_t *>(run.data()), run.size(),
+                                                   sizeof(Stamp) / sizeof(std::int64_t), field_word<Field>(run),
+                                                   limit.time_since_epoch().count());
+        } else {
+            count += std::count_if(run.begin(), run.end(),
+                                   [limit](const Stamp &stamp) { return stamp.*Field > limit; });
+        }
+        first += run.size();
+    }
+    return count;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <auto Field>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::field_word(std::span<const Stamp> run) {
+    // the index of the 64 bit word of a stamp that holds Field
+    const Stamp &stamp = run.front();
+    return static_cast<std::size_t>(reinterpret_cast<const std::byte *>(&(stamp.*Field)) -
+                                    reinterpret_cast<const std::byte *>(&stamp)) /
+           sizeof(std::int64_t);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Vector
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::collect(
+    const Snapshot &snapshot, std::size_t first, std::size_t last, TimePoint now) const {
+    Vector data(allocator);
+    data.reserve(last - first);
+    for (; first != last; ++first) {
+        if (is_valid(snapshot.stamp(first), now)) {
+            data.push_back(snapshot[first]);
+        }
+    }
+    return data;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::is_valid(
+    const Stamp &stamp, TimePoint now) {
+    // with a fixed TTL everything a snapshot holds has already been checked by remove_expired
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        return stamp.expiration > now;
+    } else {
+        return true;
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::Stamp
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::make_stamp(
+    TimePoint insertion, TimePoint expiration) {
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        return Stamp{insertion, expiration};
+    } else {
+        return Stamp{insertion};
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                               Aggregates, Stats>::TimePoint
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::expiration_of(
+    const Stamp &stamp) const {
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        return stamp.expiration;
+    } else {
+        return stamp.insertion + fixed_ttl();
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::snapshot_to(std::vector<std::byte> &out) {
+    snapshot_to(out, Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::snapshot_to(std::vector<std::byte> &out, TimePoint now) {
+    static_assert(std::is_trivially_copyable_v<T>, "snapshots hold the bytes of the elements");
+    Snapshot view = snapshot(now);
+    snapshot_io::Header header = snapshot_header(view);
+    std::vector<std::int64_t> times = snapshot_times(view, now);
+    std::size_t at = out.size();
+    out.resize(at + sizeof(header) + header.body_bytes());
+    std::memcpy(out.data() + at, &header, sizeof(header));
+    at += sizeof(header);
+    std::memcpy(out.data() + at, times.data(), times.size() * sizeof(std::int64_t));
+    at += times.size() * sizeof(std::int64_t);
+    for (std::size_t offset = 0; offset < view.size();) {
+        std::span<const T> run = view.slot_run(offset);
+        std::memcpy(out.data() + at, run.data(), run.size_bytes());
+        at += run.size_bytes();
+        offset += run.size();
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::snapshot_to(int fd) {
+    snapshot_to(fd, Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::snapshot_to(int fd, TimePoint now) {
+    static_assert(std::is_trivially_copyable_v<T>, "snapshots hold the bytes of the elements");
+    Snapshot view = snapshot(now);
+    snapshot_io::Header header = snapshot_header(view);
+    std::vector<std::int64_t> times = snapshot_times(view, now);
+    std::vector<snapshot_io::Piece> pieces{std::as_bytes(std::span(&header, 1)), std::as_bytes(std::span(times))};
+    for (std::size_t offset = 0; offset < view.size();) {
+        std::span<const T> run = view.slot_run(offset);
+        pieces.push_back(std::as_bytes(run));
+        offset += run.size();
+    }
+    snapshot_io::write_all(fd, pieces);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::restore_from(std::span<const std::byte> data) {
+    return restore_from(data, Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::restore_from(std::span<const std::byte> data, TimePoint now) {
+    static_assert(std::is_trivially_copyable_v<T>, "snapshots hold the bytes of the elements");
+    snapshot_io::Header header = snapshot_io::read_header(data, sizeof(T));
+    std::size_t count = static_cast<std::size_t>(header.count);
+    const std::byte *ages = data.data() + sizeof(header);
+    const std::byte *remainders = ages + count * sizeof(std::int64_t);
+    const std::byte *elements = remainders + (header.per_item_ttl ? count * sizeof(std::int64_t) : 0);
+    auto time_at = [](const std::byte *times, std::size_t i) {
+        std::int64_t nanoseconds;
+        std::memcpy(&nanoseconds, times + i * sizeof(nanoseconds), sizeof(nanoseconds));
+        return std::chrono::duration_cast<typename Clock::duration>(std::chrono::nanoseconds(nanoseconds));
+    };
+    std::size_t restored = 0;
+    TimePoint earliest = TimePoint::max();
+    bool wake = false;
+    {
+        std::unique_lock<Mutex> lock(mtx);
+        evict_lazily(now);
+        if (capacity == 0) {
+            storage.reserve_back(count);
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            TimePoint insertion = std::max(now - time_at(ages, i), last_insertion);
+            // only a container with per item TTLs takes the remainders, any other applies its duration
+            TimePoint expiration = ExpirationPolicy::per_item_ttl && header.per_item_ttl
+                                       ? std::max(now + time_at(remainders, i), insertion)
+                                       : insertion + fixed_ttl();
+            if (expiration <= now) {
+                continue;
+            }
+            if (!make_room(lock, now)) {
+                break;
+            }
+            last_insertion = insertion;
+            std::array<std::byte, sizeof(T)> bytes;
+            std::memcpy(bytes.data(), elements + i * sizeof(T), sizeof(T));
+            append(insertion, expiration, std::bit_cast<T>(bytes));
+            wake = brings_deadline_forward(expiration) || wake;
+            earliest = std::min(earliest, expiration);
+            ++restored;
+        }
+        finish_insert(lock);
+    }
+    if (wake) {
+        wake_cleanup(earliest);
+    }
+    return restored;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::restore_from(int fd) {
+    return restore_from(fd, Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::restore_from(int fd, TimePoint now) {
+    return restore_from(snapshot_io::read_snapshot(fd, sizeof(T)), now);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+snapshot_io::Header ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                          Aggregates, Stats>::snapshot_header(const Snapshot &view) const {
+    snapshot_io::Header header;
+    header.element_size = sizeof(T);
+    header.count = view.size();
+    header.per_item_ttl = ExpirationPolicy::per_item_ttl;
+    return header;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::vector<std::int64_t> ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                                Aggregates, Stats>::snapshot_times(const Snapshot &view,
+                                                                                   TimePoint now) const {
+    auto nanoseconds = [](typename Clock::duration time) {
+        return static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+    };
+    std::size_t count = view.size();
+    std::vector<std::int64_t> times(ExpirationPolicy::per_item_ttl ? 2 * count : count);
+    for (std::size_t offset = 0; offset < count; ++offset) {
+        const Stamp &stamp = view.stamp(offset);
+        times[offset] = nanoseconds(now - stamp.insertion);
+        if constexpr (ExpirationPolicy::per_item_ttl) {
+            times[count + offset] = nanoseconds(stamp.expiration - now);
+        }
+    }
+    return times;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::print_state() const {
+    Snapshot current;
+    if constexpr (ConcurrencyPolicy::lock_free_reads) {
+        current = storage.published_snapshot();
+    } else {
+        std::lock_guard<Mutex> lock(mtx);
+        current = storage.snapshot();
+    }
     std::cout << "State of the data ordered by insertion times:" << std::endl;
-    while (!temp_pq.empty()) {
+    for (std::size_t offset = 0; offset < current.size(); ++offset) {
+        const Stamp &stamp = current.stamp(offset);
         TimePoint now = Clock::now();
-        auto duration_in_data_structure = std::chrono::duration_cast<std::chrono::milliseconds>(now - temp_pq.top().insertion);
-        auto expiration_time = std::chrono::duration_cast<std::chrono::milliseconds>(temp_pq.top().expiration.time_since_epoch());
+        auto duration_in_data_structure = std::chrono::duration_cast<std::chrono::milliseconds>(now - stamp.insertion);
+        auto expiration_time = std::chrono::duration_cast<std::chrono::milliseconds>(expiration_of(stamp).time_since_epoch());
 
-        //std::cout << "Data: " << temp_pq.top().data 
-        //          << ", Insertion Time: " << temp_pq.top().insertion.time_since_epoch().count() << " ms"
+        //std::cout << "Data: " << current[offset]
+        //          << ", Insertion Time: " << stamp.insertion.time_since_epoch().count() << " ms"
         //          << ", Expiration Time: " << expiration_time.count() << " ms"
         //          << ", Duration in Data Structure: " << duration_in_data_structure.count() << " ms" << std::endl;
 
-        std::cout << ", Insertion Time: " << temp_pq.top().insertion.time_since_epoch().count() << " ms";
-
-        temp_pq.pop();
+        std::cout << ", Insertion Time: " << stamp.insertion.time_since_epoch().count() << " ms";
     }
 }
 
-template <typename T>
-void ExpiringDataContainer<T>::cleanup_expired_data() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(mtx);
-        cv.wait_for(lock, fixed_duration, [this] { return stop_cleanup; });
-        if (stop_cleanup) break;
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::cleanup_expired_data() {
+    std::unique_lock<Mutex> lock(mtx);
+    while (!stop_cleanup) {
         auto now = Clock::now();
+        sweep_expired(now);
+        hand_over_expired(lock);
+        resume_waiters(lock);
+        // inserts only notify when they expire before the deadline the thread is sleeping until
+        TimePoint deadline = next_expiration().value_or(TimePoint::max());
+        wake_deadline = deadline;
+        auto woken = [this, deadline] { return stop_cleanup || wake_deadline < deadline; };
+        if (deadline == TimePoint::max()) {
+            cv.wait(lock, woken);
+        } else {
+            cv.wait_until(lock, deadline, woken);
+        }
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+bool ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::brings_deadline_forward(TimePoint expiration) {
+    // the cleanup is always due at the next expiration, so an insert only has to wake it up or schedule a
+    // sweep when it expires before that, which with a fixed TTL only happens when the container was empty
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        if (expiration < wake_deadline) {
+            wake_deadline = expiration;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::wake_cleanup(TimePoint expiration) {
+    if constexpr (std::is_same_v<Clock, ExpirationScheduler::Clock>) {
+        if (scheduler) {
+            scheduler->schedule(registration, expiration);
+            return;
+        }
+    }
+    cv.notify_one();
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::optional<typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                             Aggregates, Stats>::TimePoint>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                      Aggregates, Stats>::sweep(TimePoint now) {
+    std::unique_lock<Mutex> lock(mtx);
+    sweep_expired(now);
+    hand_over_expired(lock);
+    resume_waiters(lock);
+    std::optional<TimePoint> next = next_expiration();
+    wake_deadline = next.value_or(TimePoint::max());
+    return next;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::remove_expired(TimePoint now) {
+    std::size_t removed = 0;
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        index.advance(now);
+        for (; index.front_expired(); ++removed) {
+            pop_oldest();
+        }
+    } else {
+        // after a stall the whole expired front is found by one search instead of a comparison per element
+        removed = first_inserted_after(storage, now - fixed_ttl());
+        for (std::size_t expired = removed; expired > 0; --expired) {
+            pop_oldest();
+        }
+    }
+    counters.on_expire(removed);
+    notify_space();
+    return removed;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::sweep_expired(TimePoint now) {
+    if constexpr (Stats::enabled) {
+        // the front goes first, so how late the sweep is shows in how long ago the front expired
+        TimePoint due = storage.empty() ? now : expiration_of(storage.stamp(0));
+        if (std::size_t expired = remove_expired(now)) {
+            counters.on_sweep(expired, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due));
+        }
+    } else {
         remove_expired(now);
     }
 }
 
-template <typename T>
-void ExpiringDataContainer<T>::remove_expired(TimePoint now) {
-    while (!pq.empty() && pq.top().expiration <= now) {
-        pq.pop();
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::pop_oldest() {
+    aggregates.on_remove(storage.front());
+    if (expire_callback) {
+        storage.pop_front_into(1, [this](const Stamp &, auto &&data) {
+            expired_batch.push_back(std::forward<decltype(data)>(data));
+        });
+    } else {
+        storage.pop_front();
+    }
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        index.on_pop_front();
+    }
+    ++popped;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::hand_over_expired(std::unique_lock<Mutex> &lock) {
+    if (expired_batch.empty() || delivering_expired) {
+        // a callback that removed more data itself leaves it for the next hand over
+        return;
+    }
+    delivering.swap(expired_batch);
+    delivering_expired = true;
+    lock.unlock();
+    expire_callback(std::span<T>(delivering));
+    delivering.clear();
+    lock.lock();
+    delivering_expired = false;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::finish_removal(std::unique_lock<Mutex> &lock) {
+    resume_waiters(lock);
+    if (expired_batch.empty()) {
+        lock.unlock();
+        return;
     }
-    while (!insertion_order.empty() && insertion_order.front().expiration <= now) {
-        insertion_order.pop_front();
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        // the callback only runs on the cleanup thread or the scheduler
+        wake_deadline = TimePoint::min();
+        lock.unlock();
+        wake_cleanup(Clock::now());
+    } else {
+        hand_over_expired(lock);
+        lock.unlock();
     }
 }
 
-template <typename T>
-size_t ExpiringDataContainer<T>::size() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    return pq.size();
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::finish_insert(std::unique_lock<Mutex> &lock) {
+    if constexpr (ConcurrencyPolicy::guards_shared_state) {
+        finish_removal(lock);
+    } else {
+        // the producer of an SPSC container removes nothing, and the expired batch belongs to the consumer
+        lock.unlock();
+    }
 }
 
-template <typename T>
-T ExpiringDataContainer<T>::get_most_recent() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    if (insertion_order.empty()) {
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::resume_waiters(std::unique_lock<Mutex> &lock) {
+    if constexpr (!ConcurrencyPolicy::guards_shared_state) {
+        // nothing can wait on an SPSC container, and popped is the consumer's own
+        return;
+    }
+    std::uint64_t sequence = popped + storage.size();
+    if (insert_notifier && notified_sequence != sequence) {
+        notified_sequence = sequence;
+        insert_notifier->signal();
+    }
+    if (insert_waiters.empty() && empty_waiters.empty()) {
+        return;
+    }
+    std::vector<std::coroutine_handle<>> ready;
+    std::erase_if(insert_waiters, [&ready, sequence](const InsertWaiter &waiter) {
+        if (waiter.sequence < sequence) {
+            ready.push_back(waiter.handle);
+            return true;
+        }
+        return false;
+    });
+    if (storage.empty()) {
+        ready.insert(ready.end(), empty_waiters.begin(), empty_waiters.end());
+        empty_waiters.clear();
+    }
+    if (ready.empty()) {
+        return;
+    }
+    lock.unlock();
+    for (std::coroutine_handle<> handle : ready) {
+        handle.resume();
+    }
+    lock.lock();
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::notify_space() {
+    if (blocked_inserts > 0) {
+        space_available.notify_all();
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::reserve_capacity() {
+    if constexpr (ConcurrencyPolicy::guards_shared_state && ConcurrencyPolicy::ring_capacity > 0) {
+        // the ring is allocated already, the capacity only keeps inserts from overflowing it
+        if (capacity > ConcurrencyPolicy::ring_capacity) {
+            throw std::invalid_argument("the capacity exceeds the ring of RingPolicy");
+        }
+        if (capacity == 0) {
+            capacity = ConcurrencyPolicy::ring_capacity;
+        }
+    } else if (capacity == 0) {
+        return;
+    } else if constexpr (ConcurrencyPolicy::guards_shared_state) {
+        storage.reserve(capacity);
+    } else {
+        throw std::invalid_argument("SpscPolicy is bounded by the capacity of its ring");
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::check_static_ttl() const {
+    if constexpr (ExpirationPolicy::static_ttl) {
+        if (fixed_duration != ExpirationPolicy::ttl) {
+            throw std::invalid_argument("the duration differs from the TTL of StaticTtlPolicy");
+        }
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::optional<typename ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                             Aggregates, Stats>::TimePoint>
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::next_expiration(
+    ) const {
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        return index.next_deadline();
+    } else {
+        if (storage.empty()) {
+            return std::nullopt;
+        }
+        return expiration_of(storage.stamp(0));
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename Reader>
+auto ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::read_aggregates(Reader &&reader) {
+    return read_aggregates(std::forward<Reader>(reader), Clock::now());
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+template <typename Reader>
+auto ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::read_aggregates(Reader &&reader, TimePoint now) {
+    counters.on_query();
+    std::unique_lock<Mutex> lock(mtx);
+    remove_expired(now);
+    auto result = std::invoke(std::forward<Reader>(reader), std::as_const(aggregates));
+    finish_removal(lock);
+    return result;
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+typename Stats::Snapshot
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::stats() const {
+    static_assert(Stats::enabled, "stats() needs a container instrumented with ContainerStats");
+    return counters.snapshot();
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::tick(
+    TimePoint now) {
+    std::unique_lock<Mutex> lock(mtx);
+    remove_expired(now);
+    finish_removal(lock);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+void ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                           Aggregates, Stats>::evict_lazily(TimePoint now) {
+    if constexpr (ConcurrencyPolicy::insert_evicts) {
+        remove_expired(now);
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t
+ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator, Aggregates, Stats>::first_unexpired(
+    ) const {
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        // expirations are not sorted, but the index has already popped the expired front up to its last advance
+        return first_later<&Stamp::expiration>(storage, 0, Clock::now());
+    } else if constexpr (ConcurrencyPolicy::background_cleanup) {
+        return 0;
+    } else {
+        // const accessors cannot evict, so they skip what has expired instead, expirations are sorted like insertions
+        return first_inserted_after(storage, Clock::now() - fixed_ttl());
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                             Aggregates, Stats>::size() const {
+    std::lock_guard<Mutex> lock(mtx);
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        // the index only knows what had expired at its last advance, the stamps know what has by now
+        return count_later<&Stamp::expiration>(storage, 0, storage.size(), Clock::now());
+    } else {
+        return storage.size() - first_unexpired();
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+T ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                        Aggregates, Stats>::get_most_recent() const {
+    std::optional<T> newest = try_get_most_recent();
+    if (!newest) {
         throw std::runtime_error("No elements in the container");
     }
-    return insertion_order.back().data;
+    return std::move(*newest);
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::size_t ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                  Aggregates, Stats>::approximate_size() const {
+    if constexpr (ConcurrencyPolicy::lock_free_reads) {
+        return storage.published_size();
+    } else {
+        return storage.size();
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+std::optional<T> ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                                       Aggregates, Stats>::try_get_most_recent() const {
+    TimePoint now = Clock::now();
+    if constexpr (ConcurrencyPolicy::lock_free_reads) {
+        Snapshot valid = published_view(now);
+        // the front is valid, so this stops there at the latest
+        for (std::size_t offset = valid.size(); offset > 0; --offset) {
+            if (is_valid(valid.stamp(offset - 1), now)) {
+                return valid[offset - 1];
+            }
+        }
+        return std::nullopt;
+    } else {
+        std::lock_guard<Mutex> lock(mtx);
+        const T *newest = newest_valid(now);
+        return newest ? std::optional<T>(*newest) : std::nullopt;
+    }
+}
+
+template <typename T, typename ConcurrencyPolicy, typename ClockType, typename ExpirationPolicy, typename Allocator,
+          typename Aggregates, typename Stats>
+const T *ExpiringDataContainer<T, ConcurrencyPolicy, ClockType, ExpirationPolicy, Allocator,
+                               Aggregates, Stats>::newest_valid(TimePoint now) const {
+    if constexpr (ExpirationPolicy::per_item_ttl) {
+        for (std::size_t offset = storage.size(); offset > 0; --offset) {
+            if (storage.stamp(offset - 1).expiration > now) {
+                return &storage[offset - 1];
+            }
+        }
+        return nullptr;
+    } else {
+        return first_unexpired() == storage.size() ? nullptr : &storage.back();
+    }
 }
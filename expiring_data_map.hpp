@@ -0,0 +1,159 @@
+#ifndef EXPIRING_DATA_MAP_HPP
+#define EXPIRING_DATA_MAP_HPP
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "concurrency_policies.hpp"
+#include "expiration_scheduler.hpp"
+
+/**
+ * @brief A map whose entries expire a fixed duration after they were last inserted or refreshed.
+ *
+ * The entries are linked into an intrusive list in the order they were last touched,
+ * which with a fixed TTL is also the order they expire in, so removing expired entries
+ * only ever unlinks the front of the list, O(1) per expired entry, and refreshing an
+ * entry moves it to the back. An open addressing hash table with linear probing indexes
+ * the entries by key. Every bucket holds 32 bits of the key's hash next to the index of
+ * its entry, so a probe only compares keys whose hashes match, and erasing shifts the
+ * following buckets back instead of leaving tombstones behind. find, insert_or_refresh,
+ * refresh and erase are all O(1) expected.
+ *
+ * The entries live in a deque of nodes that never moves them, erased nodes are recycled
+ * through a free list, and everything allocates through Allocator rebound as needed.
+ *
+ * With SynchronizedPolicy every operation takes a mutex and an ExpirationScheduler sweeps
+ * the expired entries in the background, the given one or else one owned by the map.
+ * With UnsynchronizedPolicy there is neither, expired entries are removed by the map's
+ * own operations or by tick(). Either way every operation removes whatever has expired
+ * before doing anything else, so no operation ever sees an expired entry. Times must not
+ * go backwards, a time earlier than the previous one is clamped to it.
+ */
+template <typename K, typename V, typename ConcurrencyPolicy = SynchronizedPolicy,
+          typename ClockType = std::chrono::steady_clock, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>, typename Allocator = std::allocator<std::pair<const K, V>>>
+class ExpiringDataMap {
+  public:
+    using Clock = ClockType;
+    using TimePoint = std::chrono::time_point<Clock>;
+    using Duration = std::chrono::milliseconds;
+    using Mutex = typename ConcurrencyPolicy::Mutex;
+    using value_type = std::pair<const K, V>;
+
+    explicit ExpiringDataMap(Duration duration, const Allocator &allocator = Allocator());
+    ExpiringDataMap(Duration duration, ExpirationScheduler &scheduler, const Allocator &allocator = Allocator());
+    ~ExpiringDataMap();
+
+    ExpiringDataMap(const ExpiringDataMap &) = delete;
+    ExpiringDataMap &operator=(const ExpiringDataMap &) = delete;
+
+    /**
+     * @brief Inserts value under key, or replaces the value of the existing entry, and restarts the entry's TTL.
+     *
+     * Returns true when key was not in the map yet. Throws std::length_error once the map
+     * holds 2^32 - 1 entries.
+     */
+    bool insert_or_refresh(K key, V value);
+    bool insert_or_refresh(K key, V value, TimePoint now);
+
+    /**
+     * @brief Restarts the TTL of the entry under key without touching its value, returns false if there is none.
+     */
+    bool refresh(const K &key);
+    bool refresh(const K &key, TimePoint now);
+
+    // a copy of the value under key, nothing if there is none
+    std::optional<V> find(const K &key);
+    std::optional<V> find(const K &key, TimePoint now);
+    bool contains(const K &key);
+    bool contains(const K &key, TimePoint now);
+
+    // returns false if there was no entry under key
+    bool erase(const K &key);
+
+    // the number of entries that have not expired yet
+    std::size_t size() const;
+
+    /**
+     * @brief Removes the entries that have expired as of now.
+     */
+    void tick(TimePoint now = Clock::now());
+
+  private:
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::size_t min_buckets = 16;
+
+    struct Node {
+        std::optional<value_type> entry; // empty while the node is on the free list
+        TimePoint expiration{};
+        std::uint32_t fingerprint = 0;
+        std::uint32_t previous = none;
+        std::uint32_t next = none; // also links the free list
+    };
+
+    struct Bucket {
+        std::uint32_t fingerprint = 0; // the high half of the key's mixed hash, its top bits are the home bucket
+        std::uint32_t node = none;     // none for an empty bucket
+    };
+
+    template <typename U> using Rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+    std::uint32_t fingerprint_of(const K &key) const;
+    // the top log2(buckets.size()) bits of the mixed hash, whose low half fingerprint leaves out as zeros
+    std::size_t home_of(std::uint32_t fingerprint) const {
+        int bits = std::countr_zero(buckets.size());
+        return static_cast<std::size_t>((std::uint64_t{fingerprint} << 32) >> (64 - bits));
+    }
+    std::size_t find_bucket(const K &key, std::uint32_t fingerprint) const; // buckets.size() if key is not there
+    std::size_t bucket_of(std::uint32_t node) const;
+    void add_bucket(std::uint32_t fingerprint, std::uint32_t node);
+    void remove_bucket(std::size_t index);
+    void grow_buckets();
+
+    std::uint32_t allocate_node();
+    void release_node(std::uint32_t node);
+    void link_back(std::uint32_t node);
+    void unlink(std::uint32_t node);
+    void touch(std::uint32_t node, TimePoint now);
+    void remove(std::size_t bucket);
+
+    void register_sweep(ExpirationScheduler &scheduler);
+    TimePoint advance(TimePoint now);
+    void remove_expired(TimePoint now);
+    bool brings_deadline_forward();
+    void wake_cleanup(TimePoint deadline);
+    std::optional<TimePoint> sweep(TimePoint now);
+
+    [[no_unique_address]] Hash hasher;
+    [[no_unique_address]] KeyEqual key_equal;
+    Duration fixed_duration;
+    std::deque<Node, Rebind<Node>> nodes;
+    std::vector<Bucket, Rebind<Bucket>> buckets; // a power of two of them, at most three quarters full
+    std::uint32_t front = none;                  // the entry touched the longest ago
+    std::uint32_t back = none;
+    std::uint32_t free_nodes = none;
+    std::size_t entries = 0;
+    TimePoint last_touch{};
+    mutable Mutex mtx;
+    std::unique_ptr<ExpirationScheduler> owned_scheduler; // used when no scheduler is given
+    ExpirationScheduler *scheduler = nullptr;
+    ExpirationScheduler::RegistrationId registration = 0;
+    TimePoint wake_deadline = TimePoint::max(); // when the next sweep is due, max when nothing is pending
+};
+
+#include "expiring_data_map.tpp"
+
+#endif // EXPIRING_DATA_MAP_HPP
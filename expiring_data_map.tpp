@@ -0,0 +1,385 @@
+#include "expiring_data_map.hpp"
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::ExpiringDataMap(
+    Duration duration, const Allocator &allocator)
+    : fixed_duration(duration), nodes(Rebind<Node>(allocator)),
+      buckets(min_buckets, Bucket{}, Rebind<Bucket>(allocator)) {
+    static_assert(ConcurrencyPolicy::guards_shared_state,
+                  "the index and the expiry list are written by every operation, readers and writers alike");
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        owned_scheduler = std::make_unique<ExpirationScheduler>();
+        register_sweep(*owned_scheduler);
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::ExpiringDataMap(
+    Duration duration, ExpirationScheduler &scheduler, const Allocator &allocator)
+    : fixed_duration(duration), nodes(Rebind<Node>(allocator)),
+      buckets(min_buckets, Bucket{}, Rebind<Bucket>(allocator)) {
+    register_sweep(scheduler);
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::~ExpiringDataMap() {
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        scheduler->remove(registration);
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::insert_or_refresh(K key, V value) {
+    return insert_or_refresh(std::move(key), std::move(value), Clock::now());
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::insert_or_refresh(
+    K key, V value, TimePoint now) {
+    bool inserted = false;
+    bool wake = false;
+    TimePoint deadline;
+    {
+        std::lock_guard<Mutex> lock(mtx);
+        now = advance(now);
+        std::uint32_t fingerprint = fingerprint_of(key);
+        std::size_t bucket = find_bucket(key, fingerprint);
+        if (bucket != buckets.size()) {
+            std::uint32_t node = buckets[bucket].node;
+            nodes[node].entry->second = std::move(value);
+            touch(node, now);
+        } else {
+            // grow before taking a node, so that nothing is left half inserted when growing throws
+            if ((entries + 1) * 4 > buckets.size() * 3) {
+                grow_buckets();
+            }
+            std::uint32_t node = allocate_node();
+            try {
+                nodes[node].entry.emplace(std::move(key), std::move(value));
+            } catch (...) {
+                release_node(node);
+                throw;
+            }
+            nodes[node].fingerprint = fingerprint;
+            nodes[node].expiration = now + fixed_duration;
+            link_back(node);
+            add_bucket(fingerprint, node);
+            ++entries;
+            inserted = true;
+        }
+        wake = brings_deadline_forward();
+        deadline = wake_deadline;
+    }
+    if (wake) {
+        wake_cleanup(deadline);
+    }
+    return inserted;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::refresh(const K &key) {
+    return refresh(key, Clock::now());
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::refresh(
+    const K &key, TimePoint now) {
+    // moving an entry to the back only ever makes the front expire later, the pending sweep finds out by itself
+    std::lock_guard<Mutex> lock(mtx);
+    now = advance(now);
+    std::size_t bucket = find_bucket(key, fingerprint_of(key));
+    if (bucket == buckets.size()) {
+        return false;
+    }
+    touch(buckets[bucket].node, now);
+    return true;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::optional<V> ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::find(const K &key) {
+    return find(key, Clock::now());
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::optional<V> ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::find(
+    const K &key, TimePoint now) {
+    std::lock_guard<Mutex> lock(mtx);
+    advance(now);
+    std::size_t bucket = find_bucket(key, fingerprint_of(key));
+    if (bucket == buckets.size()) {
+        return std::nullopt;
+    }
+    return nodes[buckets[bucket].node].entry->second;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::contains(const K &key) {
+    return contains(key, Clock::now());
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::contains(
+    const K &key, TimePoint now) {
+    std::lock_guard<Mutex> lock(mtx);
+    advance(now);
+    return find_bucket(key, fingerprint_of(key)) != buckets.size();
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::erase(const K &key) {
+    std::lock_guard<Mutex> lock(mtx);
+    advance(Clock::now());
+    std::size_t bucket = find_bucket(key, fingerprint_of(key));
+    if (bucket == buckets.size()) {
+        return false;
+    }
+    remove(bucket);
+    return true;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::size_t ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::size() const {
+    std::lock_guard<Mutex> lock(mtx);
+    TimePoint now = std::max(Clock::now(), last_touch);
+    std::size_t expired = 0;
+    for (std::uint32_t node = front; node != none && nodes[node].expiration <= now; node = nodes[node].next) {
+        ++expired;
+    }
+    return entries - expired;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::tick(TimePoint now) {
+    std::lock_guard<Mutex> lock(mtx);
+    advance(now);
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::uint32_t ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::fingerprint_of(
+    const K &key) const {
+    // std::hash is the identity for integers, multiplying spreads every bit of the hash into the high half, and
+    // the higher a bit of the product the more bits of the hash it depends on
+    std::uint64_t mixed = static_cast<std::uint64_t>(hasher(key)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<std::uint32_t>(mixed >> 32);
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::size_t ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::find_bucket(
+    const K &key, std::uint32_t fingerprint) const {
+    std::size_t mask = buckets.size() - 1;
+    for (std::size_t index = home_of(fingerprint);; index = (index + 1) & mask) {
+        const Bucket &bucket = buckets[index];
+        if (bucket.node == none) {
+            return buckets.size();
+        }
+        if (bucket.fingerprint == fingerprint && key_equal(nodes[bucket.node].entry->first, key)) {
+            return index;
+        }
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::size_t ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::bucket_of(
+    std::uint32_t node) const {
+    std::size_t mask = buckets.size() - 1;
+    std::size_t index = home_of(nodes[node].fingerprint);
+    while (buckets[index].node != node) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::add_bucket(
+    std::uint32_t fingerprint, std::uint32_t node) {
+    std::size_t mask = buckets.size() - 1;
+    std::size_t index = home_of(fingerprint);
+    while (buckets[index].node != none) {
+        index = (index + 1) & mask;
+    }
+    buckets[index] = Bucket{fingerprint, node};
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::remove_bucket(std::size_t index) {
+    // backward shift deletion: every bucket after the hole that may still be found from the hole moves into it
+    std::size_t mask = buckets.size() - 1;
+    std::size_t hole = index;
+    for (std::size_t next = (hole + 1) & mask; buckets[next].node != none; next = (next + 1) & mask) {
+        std::size_t home = home_of(buckets[next].fingerprint);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            buckets[hole] = buckets[next];
+            hole = next;
+        }
+    }
+    buckets[hole] = Bucket{};
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::grow_buckets() {
+    std::vector<Bucket, Rebind<Bucket>> grown(buckets.size() * 2, Bucket{}, buckets.get_allocator());
+    grown.swap(buckets);
+    for (const Bucket &bucket : grown) {
+        if (bucket.node != none) {
+            add_bucket(bucket.fingerprint, bucket.node);
+        }
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::uint32_t ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::allocate_node() {
+    if (free_nodes != none) {
+        std::uint32_t node = free_nodes;
+        free_nodes = nodes[node].next;
+        return node;
+    }
+    if (nodes.size() == none) {
+        throw std::length_error("ExpiringDataMap holds at most 2^32 - 1 entries");
+    }
+    nodes.emplace_back();
+    return static_cast<std::uint32_t>(nodes.size() - 1);
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::release_node(std::uint32_t node) {
+    nodes[node].entry.reset();
+    nodes[node].next = free_nodes;
+    free_nodes = node;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::link_back(std::uint32_t node) {
+    nodes[node].previous = back;
+    nodes[node].next = none;
+    if (back != none) {
+        nodes[back].next = node;
+    } else {
+        front = node;
+    }
+    back = node;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::unlink(std::uint32_t node) {
+    Node &unlinked = nodes[node];
+    if (unlinked.previous != none) {
+        nodes[unlinked.previous].next = unlinked.next;
+    } else {
+        front = unlinked.next;
+    }
+    if (unlinked.next != none) {
+        nodes[unlinked.next].previous = unlinked.previous;
+    } else {
+        back = unlinked.previous;
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::touch(
+    std::uint32_t node, TimePoint now) {
+    nodes[node].expiration = now + fixed_duration;
+    if (node != back) {
+        unlink(node);
+        link_back(node);
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::remove(std::size_t bucket) {
+    std::uint32_t node = buckets[bucket].node;
+    remove_bucket(bucket);
+    unlink(node);
+    release_node(node);
+    --entries;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::register_sweep(
+    ExpirationScheduler &scheduler) {
+    static_assert(ConcurrencyPolicy::background_cleanup, "the scheduler sweeps from its own thread, which needs a "
+                                                         "synchronized map");
+    static_assert(std::is_same_v<Clock, ExpirationScheduler::Clock>, "the scheduler only keeps steady_clock time");
+    this->scheduler = &scheduler;
+    registration = scheduler.add([this](TimePoint now) { return sweep(now); });
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+typename ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::TimePoint
+ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::advance(TimePoint now) {
+    now = std::max(now, last_touch);
+    last_touch = now;
+    remove_expired(now);
+    return now;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::remove_expired(TimePoint now) {
+    // the list is ordered by expiration, so whatever has expired is at its front
+    while (front != none && nodes[front].expiration <= now) {
+        remove(bucket_of(front));
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+bool ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::brings_deadline_forward() {
+    // a sweep is always due at the front's expiration, so an insert only has to schedule one when the map was empty
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        if (front != none && nodes[front].expiration < wake_deadline) {
+            wake_deadline = nodes[front].expiration;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+void ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::wake_cleanup(TimePoint deadline) {
+    if constexpr (ConcurrencyPolicy::background_cleanup) {
+        scheduler->schedule(registration, deadline);
+    }
+}
+
+template <typename K, typename V, typename ConcurrencyPolicy, typename ClockType, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::optional<typename ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::TimePoint>
+ExpiringDataMap<K, V, ConcurrencyPolicy, ClockType, Hash, KeyEqual, Allocator>::sweep(TimePoint now) {
+    std::lock_guard<Mutex> lock(mtx);
+    advance(now);
+    std::optional<TimePoint> next;
+    if (front != none) {
+        next = nodes[front].expiration;
+    }
+    wake_deadline = next.value_or(TimePoint::max());
+    return next;
+}
@@ -0,0 +1,28 @@
+#ifndef MANUAL_CLOCK_HPP
+#define MANUAL_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief A steady clock that only moves when told to.
+ *
+ * Meant to be plugged into ExpiringDataContainer as its clock to drive simulated time
+ * in tests and benchmarks. The time is shared by every user of the clock.
+ */
+struct ManualClock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<ManualClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return time_point(duration(elapsed.load(std::memory_order_relaxed))); }
+    static void advance(duration amount) { elapsed.fetch_add(amount.count(), std::memory_order_relaxed); }
+    static void reset() { elapsed.store(0, std::memory_order_relaxed); }
+
+  private:
+    static inline std::atomic<rep> elapsed{0};
+};
+
+#endif // MANUAL_CLOCK_HPP
@@ -0,0 +1,117 @@
+#include "mapped_file_resource.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+MappedFileResource::MappedFileResource(std::string directory, std::size_t chunk_bytes, std::size_t spill_threshold,
+                                       std::pmr::memory_resource *upstream)
+    : directory(std::move(directory)), page_size(static_cast<std::size_t>(sysconf(_SC_PAGESIZE))),
+      chunk_bytes(align_up(std::max<std::size_t>(chunk_bytes, 1), page_size)), spill_threshold(spill_threshold),
+      upstream(upstream) {}
+
+MappedFileResource::~MappedFileResource() {
+    for (const Chunk &chunk : chunks) {
+        munmap(chunk.base, chunk.size);
+    }
+}
+
+std::size_t MappedFileResource::spilled_bytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return spilled;
+}
+
+std::size_t MappedFileResource::mapped_bytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return mapped;
+}
+
+void *MappedFileResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    if (!spills(bytes, alignment)) {
+        return upstream->allocate(bytes, alignment);
+    }
+    std::size_t size = block_size(bytes);
+    std::lock_guard<std::mutex> lock(mtx);
+    spilled += size;
+    auto reusable = free_blocks.find(size);
+    if (reusable != free_blocks.end() && !reusable->second.empty()) {
+        std::byte *block = reusable->second.back();
+        reusable->second.pop_back();
+        return block;
+    }
+    if (chunks.empty() || used + size > chunks.back().size) {
+        // the rest of the last chunk is left unused, its pages were never touched and take no space
+        try {
+            map_chunk(std::max(size, chunk_bytes));
+        } catch (...) {
+            spilled -= size;
+            throw;
+        }
+    }
+    std::byte *block = chunks.back().base + used;
+    used += size;
+    return block;
+}
+
+void MappedFileResource::do_deallocate(void *block, std::size_t bytes, std::size_t alignment) {
+    if (!spills(bytes, alignment)) {
+        upstream->deallocate(block, bytes, alignment);
+        return;
+    }
+    std::size_t size = block_size(bytes);
+#ifdef MADV_REMOVE
+    // the pages go back to the file system right away, a block reused later starts out as zero pages
+    madvise(block, size, MADV_REMOVE);
+#endif
+    std::lock_guard<std::mutex> lock(mtx);
+    spilled -= size;
+    free_blocks[size].push_back(static_cast<std::byte *>(block));
+}
+
+bool MappedFileResource::spills(std::size_t bytes, std::size_t alignment) const {
+    return bytes >= spill_threshold && alignment <= page_size;
+}
+
+std::size_t MappedFileResource::block_size(std::size_t bytes) const {
+    return align_up(bytes, page_size);
+}
+
+void MappedFileResource::map_chunk(std::size_t size) {
+    std::string path = directory + "/expiring-data-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = mkstemp(name.data());
+    if (fd < 0) {
+        throw std::system_error(errno, std::system_category(), "mkstemp " + path);
+    }
+    // unlinked right away, the mapping keeps the file alive and nothing is left behind after a crash
+    unlink(name.data());
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::system_category(), "ftruncate");
+    }
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        throw std::system_error(error, std::system_category(), "mmap");
+    }
+    chunks.reserve(chunks.size() + 1);
+    chunks.push_back(Chunk{static_cast<std::byte *>(base), size});
+    used = 0;
+    mapped += size;
+}
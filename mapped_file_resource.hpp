@@ -0,0 +1,122 @@
+#ifndef MAPPED_FILE_RESOURCE_HPP
+#define MAPPED_FILE_RESOURCE_HPP
+
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A memory resource that places large blocks in memory mapped files, to keep long windows out of RAM.
+ *
+ * Blocks of at least spill_threshold bytes, which with a TimeOrderedStorage are its
+ * segments, are rounded up to whole pages and carved out of chunks of chunk_bytes.
+ * Every chunk is a file created in directory, unlinked right away and mapped shared, so
+ * its pages are backed by the file rather than by swap: the kernel writes cold pages
+ * back and drops them whenever memory is short, and reading them faults them back in.
+ * Only the segments being appended to, expired or read stay in memory.
+ *
+ * A block given back has its pages punched out of the file, which frees both the
+ * memory and the disk space they took, and is kept on a free list for the next block
+ * of the same size. With the fixed size segments of a container in its steady state
+ * that next block comes along right away, so the files never grow past the largest
+ * window. Smaller blocks are passed to upstream. The chunks themselves are only
+ * unmapped when the resource is destroyed.
+ *
+ * This is meant for trivially copyable elements, whose bytes all live in the segment,
+ * anything else still keeps the memory it owns on the heap. The resource is thread
+ * safe and must outlive everything allocated from it. It needs POSIX, and punching the
+ * pages out needs Linux, elsewhere the pages of a free block stay until it is reused.
+ */
+class MappedFileResource : public std::pmr::memory_resource {
+  public:
+    static constexpr std::size_t default_chunk_bytes = std::size_t{64} << 20;
+    static constexpr std::size_t default_spill_threshold = 1024;
+
+    /**
+     * @brief Spills into files created in directory, which must exist.
+     *
+     * Allocations throw std::system_error when a file cannot be created or mapped.
+     */
+    explicit MappedFileResource(std::string directory, std::size_t chunk_bytes = default_chunk_bytes,
+                                std::size_t spill_threshold = default_spill_threshold,
+                                std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+    ~MappedFileResource() override;
+
+    MappedFileResource(const MappedFileResource &) = delete;
+    MappedFileResource &operator=(const MappedFileResource &) = delete;
+
+    // the bytes of the blocks handed out right now, whether they are in memory or not
+    std::size_t spilled_bytes() const;
+    // the bytes of every chunk mapped so far
+    std::size_t mapped_bytes() const;
+
+  private:
+    struct Chunk {
+        std::byte *base;
+        std::size_t size;
+    };
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *block, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    bool spills(std::size_t bytes, std::size_t alignment) const;
+    std::size_t block_size(std::size_t bytes) const;
+    void map_chunk(std::size_t size);
+
+    std::string directory;
+    std::size_t page_size;
+    std::size_t chunk_bytes;
+    std::size_t spill_threshold;
+    std::pmr::memory_resource *upstream;
+
+    mutable std::mutex mtx;
+    std::vector<Chunk> chunks;
+    std::map<std::size_t, std::vector<std::byte *>> free_blocks; // by block size, their pages punched out
+    std::size_t used = 0; // bytes carved from the last chunk
+    std::size_t spilled = 0;
+    std::size_t mapped = 0;
+};
+
+/**
+ * @brief A standard allocator drawing from a MappedFileResource.
+ *
+ * Copies and rebinds share the resource, so the same allocator can be handed to an
+ * ExpiringDataContainer and to everything it allocates internally.
+ */
+template <typename T> class MappedFileAllocator {
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit MappedFileAllocator(MappedFileResource &resource) noexcept : mapped(&resource) {}
+    template <typename U> MappedFileAllocator(const MappedFileAllocator<U> &other) noexcept : mapped(other.mapped) {}
+
+    T *allocate(std::size_t n) {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T *>(mapped->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *pointer, std::size_t n) noexcept { mapped->deallocate(pointer, n * sizeof(T), alignof(T)); }
+
+    MappedFileResource &resource() const noexcept { return *mapped; }
+
+    template <typename U> bool operator==(const MappedFileAllocator<U> &other) const noexcept {
+        return mapped == other.mapped;
+    }
+
+  private:
+    template <typename U> friend class MappedFileAllocator;
+
+    MappedFileResource *mapped;
+};
+
+#endif // MAPPED_FILE_RESOURCE_HPP
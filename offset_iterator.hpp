@@ -0,0 +1,71 @@
+#ifndef OFFSET_ITERATOR_HPP
+#define OFFSET_ITERATOR_HPP
+
+#include <cstddef>
+#include <iterator>
+
+/**
+ * @brief A random access const iterator over anything that can be indexed by an offset.
+ *
+ * The iterator only stores the view and an offset, dereferencing it calls view[offset],
+ * which lets the storages expose their snapshots to standard algorithms such as
+ * std::partition_point without knowing how the slots are laid out.
+ */
+template <typename View, typename Value> class OffsetIterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Value *;
+    using reference = const Value &;
+
+    OffsetIterator() = default;
+    OffsetIterator(const View *view, std::size_t offset) : view(view), offset(offset) {}
+
+    reference operator*() const { return (*view)[offset]; }
+    pointer operator->() const { return &(*view)[offset]; }
+    reference operator[](difference_type n) const { return (*view)[offset + n]; }
+
+    OffsetIterator &operator++() {
+        ++offset;
+        return *this;
+    }
+    OffsetIterator operator++(int) {
+        OffsetIterator previous = *this;
+        ++offset;
+        return previous;
+    }
+    OffsetIterator &operator--() {
+        --offset;
+        return *this;
+    }
+    OffsetIterator operator--(int) {
+        OffsetIterator previous = *this;
+        --offset;
+        return previous;
+    }
+    OffsetIterator &operator+=(difference_type n) {
+        offset += n;
+        return *this;
+    }
+    OffsetIterator &operator-=(difference_type n) {
+        offset -= n;
+        return *this;
+    }
+
+    friend OffsetIterator operator+(OffsetIterator it, difference_type n) { return it += n; }
+    friend OffsetIterator operator+(difference_type n, OffsetIterator it) { return it += n; }
+    friend OffsetIterator operator-(OffsetIterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const OffsetIterator &a, const OffsetIterator &b) {
+        return static_cast<difference_type>(a.offset) - static_cast<difference_type>(b.offset);
+    }
+
+    friend bool operator==(const OffsetIterator &a, const OffsetIterator &b) { return a.offset == b.offset; }
+    friend auto operator<=>(const OffsetIterator &a, const OffsetIterator &b) { return a.offset <=> b.offset; }
+
+  private:
+    const View *view = nullptr;
+    std::size_t offset = 0;
+};
+
+#endif // OFFSET_ITERATOR_HPP
@@ -0,0 +1,101 @@
+#ifndef SHARDED_EXPIRING_DATA_CONTAINER_HPP
+#define SHARDED_EXPIRING_DATA_CONTAINER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "expiration_scheduler.hpp"
+#include "expiring_data_container.hpp"
+
+/**
+ * @brief An expiring container striped across shards so that concurrent producers do not share a lock.
+ *
+ * Every shard is a synchronized ExpiringDataContainer with its own lock and expiry
+ * state. Each thread inserts into the shard picked for it on its first insert, threads
+ * being handed out round robin, so with at least as many shards as producers no two
+ * producers ever contend. Expired data is removed by one ExpirationScheduler for all
+ * shards, owned by the container unless one is given.
+ *
+ * Reads merge the shards in insertion time order, elements inserted at the same time
+ * ordered by shard. Each shard is read through a snapshot of its published segments in
+ * turn, without taking its lock, so a read never blocks a producer. A read is consistent
+ * within every shard, holding exactly the elements published when its snapshot was taken,
+ * but the snapshots are taken one after another and may see an insert into one shard and
+ * miss an earlier one into another.
+ */
+template <typename T, typename ExpirationPolicy = FixedTtlPolicy, typename Allocator = std::allocator<T>>
+class ShardedExpiringDataContainer {
+  public:
+    using Shard = ExpiringDataContainer<T, SynchronizedPolicy, ExpirationScheduler::Clock, ExpirationPolicy, Allocator>;
+    using Clock = typename Shard::Clock;
+    using TimePoint = typename Shard::TimePoint;
+    using Duration = typename Shard::Duration;
+    using Vector = typename Shard::Vector;
+
+    // one shard per hardware thread
+    static std::size_t default_shard_count();
+
+    /**
+     * @brief Creates shard_count shards, throws std::invalid_argument for 0.
+     */
+    explicit ShardedExpiringDataContainer(Duration duration, std::size_t shard_count = default_shard_count(),
+                                          const Allocator &allocator = Allocator());
+    ShardedExpiringDataContainer(Duration duration, ExpirationScheduler &scheduler,
+                                 std::size_t shard_count = default_shard_count(),
+                                 const Allocator &allocator = Allocator());
+
+    ShardedExpiringDataContainer(const ShardedExpiringDataContainer &) = delete;
+    ShardedExpiringDataContainer &operator=(const ShardedExpiringDataContainer &) = delete;
+
+    bool insert(const T &data) { return local_shard().insert(data); }
+    bool insert(T &&data) { return local_shard().insert(std::move(data)); }
+    bool insert(const T &data, TimePoint now) { return local_shard().insert(data, now); }
+    bool insert(T &&data, TimePoint now) { return local_shard().insert(std::move(data), now); }
+    template <typename... Args> bool emplace(Args &&...args) {
+        return local_shard().emplace(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Only available with PerItemTtlPolicy, see ExpiringDataContainer::insert.
+     */
+    bool insert(const T &data, Duration ttl) { return local_shard().insert(data, ttl); }
+    bool insert(T &&data, Duration ttl) { return local_shard().insert(std::move(data), ttl); }
+
+    /**
+     * @brief Inserts the whole batch into the calling thread's shard under a single lock acquisition.
+     */
+    std::size_t insert_batch(std::span<const T> batch) { return local_shard().insert_batch(batch); }
+
+    Vector get_valid_data();
+    Vector get_valid_data(TimePoint now);
+    Vector get_data_exceeding(TimePoint time);
+
+    size_t size() const;
+    T get_most_recent() const;
+
+    std::size_t shard_count() const { return shards.size(); }
+
+  private:
+    using Snapshot = typename Shard::Snapshot;
+
+    void add_shards(Duration duration, ExpirationScheduler &scheduler, std::size_t shard_count);
+    Shard &local_shard();
+    static std::size_t thread_ordinal();
+    Vector merge_after(TimePoint time, TimePoint now);
+
+    Allocator allocator;
+    std::unique_ptr<ExpirationScheduler> owned_scheduler; // declared first so it outlives the shards
+    std::vector<std::unique_ptr<Shard>> shards;           // separate allocations keep the shard locks apart
+};
+
+#include "sharded_expiring_data_container.tpp"
+
+#endif // SHARDED_EXPIRING_DATA_CONTAINER_HPP
@@ -0,0 +1,147 @@
+#include "sharded_expiring_data_container.hpp"
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+std::size_t ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::default_shard_count() {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::ShardedExpiringDataContainer(
+    Duration duration, std::size_t shard_count, const Allocator &allocator)
+    : allocator(allocator), owned_scheduler(std::make_unique<ExpirationScheduler>()) {
+    add_shards(duration, *owned_scheduler, shard_count);
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::ShardedExpiringDataContainer(
+    Duration duration, ExpirationScheduler &scheduler, std::size_t shard_count, const Allocator &allocator)
+    : allocator(allocator) {
+    add_shards(duration, scheduler, shard_count);
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+void ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::add_shards(
+    Duration duration, ExpirationScheduler &scheduler, std::size_t shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("ShardedExpiringDataContainer needs at least one shard");
+    }
+    shards.reserve(shard_count);
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        shards.push_back(std::make_unique<Shard>(duration, scheduler, this->allocator));
+    }
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+typename ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::Vector
+ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::get_valid_data() {
+    return get_valid_data(Clock::now());
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+typename ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::Vector
+ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::get_valid_data(TimePoint now) {
+    return merge_after(TimePoint::min(), now);
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+typename ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::Vector
+ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::get_data_exceeding(TimePoint time) {
+    return merge_after(time, Clock::now());
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+size_t ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::size() const {
+    std::size_t total = 0;
+    for (const auto &shard : shards) {
+        total += shard->size();
+    }
+    return total;
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+T ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::get_most_recent() const {
+    TimePoint now = Clock::now();
+    std::vector<Snapshot> views;
+    views.reserve(shards.size());
+    const T *most_recent = nullptr;
+    TimePoint most_recent_insertion;
+    for (const auto &shard : shards) {
+        const Snapshot &view = views.emplace_back(shard->snapshot(now));
+        // with per item TTLs an expired element may still be stored behind a longer lived one
+        for (std::size_t offset = view.size(); offset > 0; --offset) {
+            if (Shard::is_valid(view.stamp(offset - 1), now)) {
+                if (!most_recent || view.stamp(offset - 1).insertion > most_recent_insertion) {
+                    most_recent = &view[offset - 1];
+                    most_recent_insertion = view.stamp(offset - 1).insertion;
+                }
+                break;
+            }
+        }
+    }
+    if (!most_recent) {
+        throw std::runtime_error("No elements in the container");
+    }
+    return *most_recent;
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+typename ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::Shard &
+ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::local_shard() {
+    return *shards[thread_ordinal() % shards.size()];
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+std::size_t ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::thread_ordinal() {
+    static std::atomic<std::size_t> next_ordinal{0};
+    thread_local std::size_t ordinal = next_ordinal.fetch_add(1, std::memory_order_relaxed);
+    return ordinal;
+}
+
+template <typename T, typename ExpirationPolicy, typename Allocator>
+typename ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::Vector
+ShardedExpiringDataContainer<T, ExpirationPolicy, Allocator>::merge_after(TimePoint time, TimePoint now) {
+    struct Run {
+        Snapshot view;
+        std::size_t next; // offset of the run's next element
+    };
+
+    std::vector<Run> runs;
+    runs.reserve(shards.size());
+    std::size_t total = 0;
+    for (const auto &shard : shards) {
+        Run &run = runs.emplace_back(Run{shard->snapshot(now), 0});
+        run.next = Shard::first_inserted_after(run.view, time);
+        total += run.view.size() - run.next;
+    }
+
+    // a k-way merge over the shards, every shard being sorted by insertion time already
+    std::vector<std::size_t> heap;
+    heap.reserve(runs.size());
+    auto later = [&runs](std::size_t a, std::size_t b) {
+        TimePoint first = runs[a].view.stamp(runs[a].next).insertion;
+        TimePoint second = runs[b].view.stamp(runs[b].next).insertion;
+        return first != second ? first > second : a > b;
+    };
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        if (runs[i].next != runs[i].view.size()) {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    Vector data(allocator);
+    data.reserve(total);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Run &run = runs[heap.back()];
+        if (Shard::is_valid(run.view.stamp(run.next), now)) {
+            data.push_back(run.view[run.next]);
+        }
+        if (++run.next == run.view.size()) {
+            heap.pop_back();
+        } else {
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+    return data;
+}
@@ -0,0 +1,61 @@
+#include "slab_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+
+SlabPool::~SlabPool() {
+    for (void *chunk : chunks) {
+        ::operator delete(chunk, std::align_val_t(alignof(std::max_align_t)));
+    }
+}
+
+SlabPool &SlabPool::shared() {
+    // never destroyed, containers with static storage duration may still give blocks back during exit
+    static SlabPool *pool = new SlabPool;
+    return *pool;
+}
+
+void *SlabPool::do_allocate(std::size_t bytes, std::size_t alignment) {
+    if (!pooled(bytes, alignment)) {
+        return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    std::size_t index = size_class(bytes);
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!free_lists[index]) {
+        refill(index);
+    }
+    FreeBlock *block = free_lists[index];
+    free_lists[index] = block->next;
+    return block;
+}
+
+void SlabPool::do_deallocate(void *block, std::size_t bytes, std::size_t alignment) {
+    if (!pooled(bytes, alignment)) {
+        ::operator delete(block, std::align_val_t(alignment));
+        return;
+    }
+    std::size_t index = size_class(bytes);
+    std::lock_guard<std::mutex> lock(mtx);
+    free_lists[index] = ::new (block) FreeBlock{free_lists[index]};
+}
+
+bool SlabPool::pooled(std::size_t bytes, std::size_t alignment) {
+    return bytes <= max_block && alignment <= alignof(std::max_align_t);
+}
+
+std::size_t SlabPool::size_class(std::size_t bytes) {
+    std::size_t block_size = std::bit_ceil(std::max(bytes, min_block));
+    return static_cast<std::size_t>(std::countr_zero(block_size) - std::countr_zero(min_block));
+}
+
+void SlabPool::refill(std::size_t index) {
+    std::size_t block_size = min_block << index;
+    std::size_t size = std::max(block_size, chunk_bytes);
+    chunks.reserve(chunks.size() + 1);
+    std::byte *chunk = static_cast<std::byte *>(::operator new(size, std::align_val_t(alignof(std::max_align_t))));
+    chunks.push_back(chunk);
+    // thread the blocks onto the free list back to front so they are handed out in address order
+    for (std::size_t offset = size; offset >= block_size; offset -= block_size) {
+        free_lists[index] = ::new (chunk + offset - block_size) FreeBlock{free_lists[index]};
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SLAB_POOL_HPP
+#define SLAB_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A memory resource that recycles fixed size blocks instead of returning them to the heap.
+ *
+ * Requests are rounded up to a power of two size class between min_block and max_block,
+ * every class keeping an intrusive free list of the blocks that were given back to it.
+ * Fresh blocks are carved out of chunks of at least chunk_bytes, so once a workload has
+ * reached its steady state every allocation is served from a free list and the heap is
+ * never touched again. Memory only goes back to the heap when the pool is destroyed.
+ * Larger or over-aligned requests are passed straight through to the heap.
+ *
+ * The pool is thread safe, since the last reference to a storage segment may be dropped
+ * by whichever thread held a snapshot of it.
+ */
+class SlabPool : public std::pmr::memory_resource {
+  public:
+    static constexpr std::size_t min_block = 16;
+    static constexpr std::size_t max_block = std::size_t{1} << 20;
+    static constexpr std::size_t chunk_bytes = std::size_t{1} << 16;
+
+    SlabPool() = default;
+    ~SlabPool() override;
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    /**
+     * @brief The pool used by default constructed PoolAllocators, it lives until the process exits.
+     */
+    static SlabPool &shared();
+
+  private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    static constexpr std::size_t class_count = 17; // min_block << 16 == max_block
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *block, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    static bool pooled(std::size_t bytes, std::size_t alignment);
+    static std::size_t size_class(std::size_t bytes);
+    void refill(std::size_t index);
+
+    std::mutex mtx;
+    std::array<FreeBlock *, class_count> free_lists{};
+    std::vector<void *> chunks; // everything carved into blocks, released with the pool
+};
+
+/**
+ * @brief A standard allocator drawing from a SlabPool, SlabPool::shared() unless given another one.
+ *
+ * Copies and rebinds share the pool, so the same allocator can be handed to an
+ * ExpiringDataContainer and to everything it allocates internally.
+ */
+template <typename T> class PoolAllocator {
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    PoolAllocator() noexcept : pool(&SlabPool::shared()) {}
+    explicit PoolAllocator(SlabPool &pool) noexcept : pool(&pool) {}
+    template <typename U> PoolAllocator(const PoolAllocator<U> &other) noexcept : pool(other.pool) {}
+
+    T *allocate(std::size_t n) {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T *>(pool->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *pointer, std::size_t n) noexcept { pool->deallocate(pointer, n * sizeof(T), alignof(T)); }
+
+    SlabPool &resource() const noexcept { return *pool; }
+
+    template <typename U> bool operator==(const PoolAllocator<U> &other) const noexcept { return pool == other.pool; }
+
+  private:
+    template <typename U> friend class PoolAllocator;
+
+    SlabPool *pool;
+};
+
+#endif // SLAB_POOL_HPP
@@ -0,0 +1,110 @@
+#include "snapshot_io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace snapshot_io {
+
+namespace {
+// the body read_snapshot reads before it has seen a byte of it
+constexpr std::size_t read_chunk = 1 << 20;
+} // namespace
+
+Header read_header(std::span<const std::byte> data, std::size_t element_size) {
+    Header header;
+    if (data.size() < sizeof(Header)) {
+        throw std::invalid_argument("a snapshot starts with a header");
+    }
+    std::memcpy(&header, data.data(), sizeof(Header));
+    check_header(header, element_size);
+    // checked by division, a corrupt count must not overflow into a small size
+    if (header.count > (data.size() - sizeof(Header)) / header.element_bytes()) {
+        throw std::invalid_argument("the snapshot is truncated");
+    }
+    return header;
+}
+
+void check_header(const Header &header, std::size_t element_size) {
+    if (header.magic != Header::expected_magic || header.version != Header::current_version) {
+        throw std::invalid_argument("not a snapshot of this format");
+    }
+    if (header.element_size != element_size) {
+        throw std::invalid_argument("the snapshot holds elements of another size");
+    }
+}
+
+std::vector<std::byte> read_snapshot(int fd, std::size_t element_size) {
+    std::vector<std::byte> data(sizeof(Header));
+    read_all(fd, data);
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    check_header(header, element_size);
+    if (header.count > (data.max_size() - sizeof(Header)) / header.element_bytes()) {
+        throw std::invalid_argument("the snapshot holds more elements than fit in memory");
+    }
+    std::size_t size = sizeof(Header) + static_cast<std::size_t>(header.body_bytes());
+    while (data.size() < size) {
+        // at most double what has been read so far, the resize copies only what the file really held
+        std::size_t filled = data.size();
+        data.resize(std::min(size, std::max(filled * 2, filled + read_chunk)));
+        read_all(fd, std::span(data).subspan(filled));
+    }
+    return data;
+}
+
+void write_all(int fd, std::span<const Piece> pieces) {
+    std::vector<iovec> vectors;
+    vectors.reserve(pieces.size());
+    for (Piece piece : pieces) {
+        if (!piece.empty()) {
+            vectors.push_back({const_cast<std::byte *>(piece.data()), piece.size()});
+        }
+    }
+    std::size_t first = 0;
+    while (first < vectors.size()) {
+        int batch = static_cast<int>(std::min<std::size_t>(vectors.size() - first, IOV_MAX));
+        ssize_t written = writev(fd, &vectors[first], batch);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "writev");
+        }
+        // a short write leaves the rest of the batch, possibly starting in the middle of a piece
+        std::size_t left = static_cast<std::size_t>(written);
+        while (first < vectors.size() && left >= vectors[first].iov_len) {
+            left -= vectors[first].iov_len;
+            ++first;
+        }
+        if (left > 0) {
+            vectors[first].iov_base = static_cast<std::byte *>(vectors[first].iov_base) + left;
+            vectors[first].iov_len -= left;
+        }
+    }
+}
+
+void read_all(int fd, std::span<std::byte> into) {
+    while (!into.empty()) {
+        ssize_t got = read(fd, into.data(), into.size());
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "read");
+        }
+        if (got == 0) {
+            throw std::invalid_argument("the snapshot is truncated");
+        }
+        into = into.subspan(static_cast<std::size_t>(got));
+    }
+}
+
+} // namespace snapshot_io
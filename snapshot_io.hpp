@@ -0,0 +1,69 @@
+#ifndef SNAPSHOT_IO_HPP
+#define SNAPSHOT_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * The binary format written by ExpiringDataContainer::snapshot_to, in the byte order of the writing machine:
+ *   Header
+ *   count ages        int64 nanoseconds since each element was inserted, oldest element first
+ *   count remainders  int64 nanoseconds each element had left to live, only when per_item_ttl is set
+ *   count elements    the object representation of each element, element_size bytes apiece
+ * All times are relative to the moment of the snapshot, so they survive a restart and
+ * a clock with a different epoch.
+ */
+namespace snapshot_io {
+
+struct Header {
+    static constexpr std::uint32_t expected_magic = 0x53434445; // "EDCS" read as little endian bytes
+    static constexpr std::uint32_t current_version = 1;
+
+    std::uint32_t magic = expected_magic;
+    std::uint32_t version = current_version;
+    std::uint64_t element_size = 0;
+    std::uint64_t count = 0;
+    std::uint64_t per_item_ttl = 0;
+
+    // the bytes each element takes up in the body
+    std::uint64_t element_bytes() const { return (per_item_ttl ? 2 : 1) * sizeof(std::int64_t) + element_size; }
+    // the bytes following the header
+    std::uint64_t body_bytes() const { return count * element_bytes(); }
+};
+
+using Piece = std::span<const std::byte>;
+
+/**
+ * @brief Reads the header at the start of data, checking that a whole snapshot of element_size byte elements follows.
+ *
+ * Throws std::invalid_argument for anything else.
+ */
+Header read_header(std::span<const std::byte> data, std::size_t element_size);
+// the checks of read_header that need nothing but the header itself
+void check_header(const Header &header, std::size_t element_size);
+
+/**
+ * @brief Reads a whole snapshot of element_size byte elements from fd's current offset, header included.
+ *
+ * The buffer grows with the body as it arrives, so a corrupt count runs into the end of
+ * the file long before it could allocate much. Throws like read_header and read_all.
+ */
+std::vector<std::byte> read_snapshot(int fd, std::size_t element_size);
+
+/**
+ * @brief Writes every piece to fd in order, gathering up to IOV_MAX of them into each writev.
+ *
+ * Throws std::system_error when a write fails.
+ */
+void write_all(int fd, std::span<const Piece> pieces);
+
+/**
+ * @brief Fills into from fd, throws std::system_error when a read fails and std::invalid_argument at end of file.
+ */
+void read_all(int fd, std::span<std::byte> into);
+
+} // namespace snapshot_io
+
+#endif // SNAPSHOT_IO_HPP
@@ -0,0 +1,151 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "offset_iterator.hpp"
+
+/**
+ * @brief A fixed capacity, lock-free FIFO of slots for one producer and one consumer.
+ *
+ * It offers the same interface as TimeOrderedStorage so that a container can swap one
+ * for the other, but the operations are split between two threads: emplace_back is
+ * the producer's, everything that reads or pops slots is the consumer's. size and
+ * empty can be called from either thread. The producer publishes a slot by advancing
+ * tail with release semantics and the consumer frees it by advancing head the same
+ * way, so neither side ever waits for the other.
+ *
+ * The capacity is fixed, emplace_back throws std::length_error when the consumer has
+ * fallen Capacity slots behind. The slots, and the stamps kept in an array of their
+ * own next to them, are allocated once, through Allocator.
+ */
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator = std::allocator<Slot>>
+class SpscRing {
+  public:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<Stamp>, "stamps are kept in raw storage and never destroyed");
+
+    /**
+     * @brief A view of the slots that were stored when it was taken.
+     *
+     * The slots are not copied nor pinned, so the view is only valid on the consumer
+     * thread until it pops from the ring again.
+     */
+    class Snapshot {
+      public:
+        using const_iterator = OffsetIterator<Snapshot, Slot>;
+
+        Snapshot() = default;
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, count); }
+
+        const Slot &operator[](std::size_t offset) const { return *ring->slot(head + offset); }
+        const Slot &front() const { return (*this)[0]; }
+        const Slot &back() const { return (*this)[count - 1]; }
+
+        const Stamp &stamp(std::size_t offset) const { return *ring->stamp_at(head + offset); }
+        // the stamps from offset on that are contiguous in memory, up to where the ring wraps or the view ends
+        std::span<const Stamp> stamp_run(std::size_t offset) const {
+            return ring->stamp_run(head + offset, count - offset);
+        }
+        // the same for the slots
+        std::span<const Slot> slot_run(std::size_t offset) const {
+            std::size_t index = (head + offset) & mask;
+            return {ring->slot(head + offset), std::min(Capacity - index, count - offset)};
+        }
+
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+      private:
+        friend class SpscRing;
+
+        const SpscRing *ring = nullptr;
+        std::size_t head = 0;
+        std::size_t count = 0;
+    };
+
+    explicit SpscRing(const Allocator &allocator = Allocator());
+    ~SpscRing();
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // producer
+    template <typename... Args> Slot &emplace_back(const Stamp &stamp, Args &&...args);
+    void reserve_back(std::size_t) {} // the capacity is fixed
+
+    // consumer
+    void pop_front();
+    void clear();
+    template <typename Sink> void pop_front_into(std::size_t n, Sink &&sink);
+
+    Slot &front() { return (*this)[0]; }
+    const Slot &front() const { return (*this)[0]; }
+    Slot &back() { return *slot(tail.load(std::memory_order_acquire) - 1); }
+    const Slot &back() const { return *slot(tail.load(std::memory_order_acquire) - 1); }
+
+    Slot &operator[](std::size_t offset) { return *slot(head.load(std::memory_order_relaxed) + offset); }
+    const Slot &operator[](std::size_t offset) const { return *slot(head.load(std::memory_order_relaxed) + offset); }
+    const Stamp &stamp(std::size_t offset) const { return *stamp_at(head.load(std::memory_order_relaxed) + offset); }
+    std::span<const Stamp> stamp_run(std::size_t offset) const {
+        return stamp_run(head.load(std::memory_order_relaxed) + offset, size() - offset);
+    }
+
+    Snapshot snapshot() const;
+
+    // either thread
+    std::size_t size() const;
+    bool empty() const { return size() == 0; }
+
+  private:
+    static constexpr std::size_t mask = Capacity - 1;
+    static constexpr std::size_t cache_line = 64;
+
+    struct alignas(Slot) RawSlot {
+        std::byte bytes[sizeof(Slot)];
+    };
+    struct alignas(Stamp) RawStamp {
+        std::byte bytes[sizeof(Stamp)];
+    };
+
+    Slot *slot(std::size_t position) { return std::launder(reinterpret_cast<Slot *>(&slots[position & mask])); }
+    const Slot *slot(std::size_t position) const {
+        return std::launder(reinterpret_cast<const Slot *>(&slots[position & mask]));
+    }
+    Stamp *stamp_at(std::size_t position) {
+        return std::launder(reinterpret_cast<Stamp *>(&stamps[position & mask]));
+    }
+    const Stamp *stamp_at(std::size_t position) const {
+        return std::launder(reinterpret_cast<const Stamp *>(&stamps[position & mask]));
+    }
+
+    std::span<const Stamp> stamp_run(std::size_t position, std::size_t remaining) const {
+        std::size_t index = position & mask;
+        return {stamp_at(position), std::min(Capacity - index, remaining)};
+    }
+
+    using RawAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<RawSlot>;
+    using RawStampAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<RawStamp>;
+
+    RawAllocator allocator;
+    RawSlot *slots;
+    RawStamp *stamps;
+    // head and tail only ever grow, their difference is the number of stored slots
+    alignas(cache_line) std::atomic<std::size_t> head{0};
+    alignas(cache_line) std::atomic<std::size_t> tail{0};
+    alignas(cache_line) std::size_t producer_head_cache = 0; // the producer's last view of head
+};
+
+#include "spsc_ring.tpp"
+
+#endif // SPSC_RING_HPP
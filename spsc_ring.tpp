@@ -0,0 +1,78 @@
+#include "spsc_ring.hpp"
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+SpscRing<Slot, Stamp, Capacity, Allocator>::SpscRing(const Allocator &allocator)
+    : allocator(allocator), slots(std::allocator_traits<RawAllocator>::allocate(this->allocator, Capacity)) {
+    RawStampAllocator stamp_allocator(this->allocator);
+    try {
+        stamps = std::allocator_traits<RawStampAllocator>::allocate(stamp_allocator, Capacity);
+    } catch (...) {
+        std::allocator_traits<RawAllocator>::deallocate(this->allocator, slots, Capacity);
+        throw;
+    }
+}
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+SpscRing<Slot, Stamp, Capacity, Allocator>::~SpscRing() {
+    clear();
+    RawStampAllocator stamp_allocator(allocator);
+    std::allocator_traits<RawStampAllocator>::deallocate(stamp_allocator, stamps, Capacity);
+    std::allocator_traits<RawAllocator>::deallocate(allocator, slots, Capacity);
+}
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+template <typename... Args>
+Slot &SpscRing<Slot, Stamp, Capacity, Allocator>::emplace_back(const Stamp &stamp, Args &&...args) {
+    std::size_t position = tail.load(std::memory_order_relaxed);
+    if (position - producer_head_cache == Capacity) {
+        producer_head_cache = head.load(std::memory_order_acquire);
+        if (position - producer_head_cache == Capacity) {
+            throw std::length_error("SpscRing is full");
+        }
+    }
+    Slot *constructed = ::new (static_cast<void *>(slot(position))) Slot(std::forward<Args>(args)...);
+    ::new (static_cast<void *>(stamp_at(position))) Stamp(stamp);
+    tail.store(position + 1, std::memory_order_release);
+    return *constructed;
+}
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+void SpscRing<Slot, Stamp, Capacity, Allocator>::pop_front() {
+    std::size_t position = head.load(std::memory_order_relaxed);
+    slot(position)->~Slot();
+    head.store(position + 1, std::memory_order_release);
+}
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+void SpscRing<Slot, Stamp, Capacity, Allocator>::clear() {
+    for (std::size_t n = size(); n > 0; --n) {
+        pop_front();
+    }
+}
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+template <typename Sink>
+void SpscRing<Slot, Stamp, Capacity, Allocator>::pop_front_into(std::size_t n, Sink &&sink) {
+    // snapshots do not pin slots, so they can always be moved from
+    for (; n > 0; --n) {
+        sink(stamp(0), std::move(front()));
+        pop_front();
+    }
+}
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+typename SpscRing<Slot, Stamp, Capacity, Allocator>::Snapshot
+SpscRing<Slot, Stamp, Capacity, Allocator>::snapshot() const {
+    Snapshot snapshot;
+    snapshot.ring = this;
+    snapshot.head = head.load(std::memory_order_relaxed);
+    snapshot.count = tail.load(std::memory_order_acquire) - snapshot.head;
+    return snapshot;
+}
+
+template <typename Slot, typename Stamp, std::size_t Capacity, typename Allocator>
+std::size_t SpscRing<Slot, Stamp, Capacity, Allocator>::size() const {
+    // load head first, tail can only move further away from it in the meantime
+    std::size_t first = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_acquire) - first;
+}
@@ -0,0 +1,67 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <utility>
+
+#include "spsc_ring.hpp"
+#include "test_support.hpp"
+
+/*
+ * A producer appends a sequence of numbers while the consumer checks snapshots of the
+ * ring and pops from it, one slot at a time or a batch into a sink. Every snapshot has
+ * to be a gapless run starting at the next number the consumer expects, with every slot
+ * alive, and the consumer has to receive the whole sequence in order.
+ */
+
+namespace {
+
+constexpr std::size_t capacity = 1024;
+constexpr std::uint64_t total = 500'000;
+
+using Ring = SpscRing<Tracked, std::uint64_t, capacity>;
+
+} // namespace
+
+int main() {
+    {
+        Ring ring;
+        std::thread producer([&ring] {
+            for (std::uint64_t next = 0; next < total; ++next) {
+                while (ring.size() == capacity) {
+                    std::this_thread::yield();
+                }
+                ring.emplace_back(next, next);
+            }
+        });
+
+        Lcg random(7);
+        std::uint64_t expected = 0;
+        while (expected < total) {
+            Ring::Snapshot view = ring.snapshot();
+            check(view.size() <= capacity, "a snapshot holds more than the ring");
+            for (std::size_t offset = 0; offset < view.size(); ++offset) {
+                check(view[offset].is_alive(), "a snapshot covers a slot that is not alive");
+                check(view[offset].value == expected + offset && view.stamp(offset) == expected + offset,
+                      "a snapshot is not the next run of the sequence");
+            }
+            std::size_t n = static_cast<std::size_t>(random.below(view.size() + 1));
+            if (random.below(2) == 0) {
+                ring.pop_front_into(n, [&expected](const std::uint64_t &stamp, auto &&slot) {
+                    Tracked taken(std::forward<decltype(slot)>(slot));
+                    check(stamp == expected && taken.value == expected, "a sink got the wrong slot");
+                    ++expected;
+                });
+            } else {
+                for (; n > 0; --n, ++expected) {
+                    check(ring.front().value == expected, "the front is not the oldest slot");
+                    ring.pop_front();
+                }
+            }
+        }
+        producer.join();
+        check(ring.empty(), "the ring holds more than the producer appended");
+    }
+    check(Tracked::live.load() == 0, "a slot was destroyed twice or never");
+    std::printf("%llu slots passed through the ring\n", static_cast<unsigned long long>(total));
+}
@@ -0,0 +1,57 @@
+#ifndef TEST_SUPPORT_HPP
+#define TEST_SUPPORT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// an assert that stays on in release builds, a failed check ends the test
+inline void check(bool condition, const char *what) {
+    if (!condition) {
+        std::fprintf(stderr, "check failed: %s\n", what);
+        std::abort();
+    }
+}
+
+/**
+ * @brief A slot that knows whether it is alive, to catch readers touching slots that were never built or are gone.
+ *
+ * The canary is atomic so that the destructor's store is neither elided nor a data race
+ * with a reader that gets to the slot too late, live counts the objects in existence.
+ */
+struct Tracked {
+    static constexpr std::uint64_t alive = 0x600dcafe600dcafe;
+    static constexpr std::uint64_t dead = 0xdeadbeefdeadbeef;
+    static inline std::atomic<long> live{0};
+
+    explicit Tracked(std::uint64_t value) : value(value) { live.fetch_add(1, std::memory_order_relaxed); }
+    Tracked(const Tracked &other) : Tracked(other.value) {}
+    Tracked(Tracked &&other) noexcept : Tracked(other.value) {}
+    Tracked &operator=(const Tracked &) = delete;
+    ~Tracked() {
+        canary.store(dead, std::memory_order_relaxed);
+        live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    bool is_alive() const { return canary.load(std::memory_order_relaxed) == alive; }
+
+    std::uint64_t value;
+    std::atomic<std::uint64_t> canary{alive};
+};
+
+// a small deterministic generator, the tests must not depend on the seed of anything
+class Lcg {
+  public:
+    explicit Lcg(std::uint64_t seed) : state(seed) {}
+    // uniform enough in [0, bound)
+    std::uint64_t below(std::uint64_t bound) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (state >> 33) % bound;
+    }
+
+  private:
+    std::uint64_t state;
+};
+
+#endif // TEST_SUPPORT_HPP
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "test_support.hpp"
+#include "time_ordered_storage.hpp"
+
+/*
+ * Readers take published_snapshot() while the owner appends, pops, pops into a sink,
+ * pops everything and hands everything over with move_all_into. Every slot holds the
+ * sequence number it was appended with, also its stamp, so a reader can check that a
+ * snapshot is a gapless run of the sequence, that its front never goes back, and that
+ * every slot it covers is alive, including the slots of a snapshot held on to while the
+ * owner moves on.
+ */
+
+namespace {
+
+using Storage = TimeOrderedStorage<Tracked, std::uint64_t, std::allocator<Tracked>, true>;
+
+constexpr int rounds = 4000;
+constexpr int reader_count = 3;
+
+void check_view(const Storage::Snapshot &view) {
+    for (std::size_t offset = 0; offset < view.size(); ++offset) {
+        check(view[offset].is_alive(), "a snapshot covers a slot that is not alive");
+        check(view[offset].value == view.stamp(offset), "a slot does not match its stamp");
+        check(offset == 0 || view.stamp(offset) == view.stamp(offset - 1) + 1, "a snapshot has a gap");
+    }
+}
+
+void read_published(const Storage &storage, const std::atomic<bool> &done, std::uint64_t &views) {
+    std::uint64_t front = 0;
+    Storage::Snapshot held;
+    while (!done.load(std::memory_order_acquire)) {
+        Storage::Snapshot view = storage.published_snapshot();
+        check_view(view);
+        if (!view.empty()) {
+            check(view.stamp(0) >= front, "the front of the published slots went back");
+            front = view.stamp(0);
+            ++views;
+        }
+        // the previous snapshot has outlived whatever the owner popped in the meantime
+        check_view(held);
+        held = std::move(view);
+    }
+}
+
+} // namespace
+
+int main() {
+    std::uint64_t views[reader_count] = {};
+    {
+        Storage storage;
+        std::atomic<bool> done{false};
+        std::vector<std::thread> readers;
+        for (int reader = 0; reader < reader_count; ++reader) {
+            readers.emplace_back(read_published, std::cref(storage), std::cref(done), std::ref(views[reader]));
+        }
+
+        Lcg random(42);
+        std::uint64_t next = 0;  // the sequence number of the next append
+        std::uint64_t front = 0; // of the oldest stored slot
+        auto expect_front = [&front](const std::uint64_t &stamp, const Tracked &slot) {
+            check(stamp == front && slot.value == front && slot.is_alive(), "a sink got the wrong slot");
+            ++front;
+        };
+        for (int round = 0; round < rounds; ++round) {
+            for (std::uint64_t n = 1 + random.below(700); n > 0; --n, ++next) {
+                storage.emplace_back(next, next);
+            }
+            Storage::Snapshot held = storage.snapshot();
+            switch (random.below(5)) {
+            case 0:
+                for (std::uint64_t n = random.below(storage.size() + 1); n > 0; --n, ++front) {
+                    storage.pop_front();
+                }
+                break;
+            case 1:
+                storage.pop_front_into(random.below(storage.size() + 1), [&](const std::uint64_t &stamp, auto &&slot) {
+                    Tracked taken(std::forward<decltype(slot)>(slot));
+                    expect_front(stamp, taken);
+                });
+                break;
+            case 2:
+                storage.pop_all_into([&](const std::uint64_t &stamp, auto &&slot) { expect_front(stamp, slot); });
+                break;
+            case 3: {
+                Storage into;
+                storage.move_all_into(into);
+                check(storage.empty() && storage.published_size() == 0, "move_all_into left slots behind");
+                std::uint64_t handed_over_end = next;
+                // readers still holding the old table must see nothing of what is appended now
+                for (std::uint64_t n = random.below(300); n > 0; --n, ++next) {
+                    storage.emplace_back(next, next);
+                }
+                into.pop_all_into([&](const std::uint64_t &stamp, auto &&slot) { expect_front(stamp, slot); });
+                check(front == handed_over_end, "move_all_into did not hand every slot over");
+                break;
+            }
+            default:
+                break;
+            }
+            check(storage.size() == next - front, "the storage lost count of its slots");
+            check(storage.empty() || storage.stamp(0) == front, "the storage front is not the oldest slot");
+            check_view(held);
+        }
+        done.store(true, std::memory_order_release);
+        for (std::thread &reader : readers) {
+            reader.join();
+        }
+    }
+    check(Tracked::live.load() == 0, "a slot was destroyed twice or never");
+    std::uint64_t total = 0;
+    for (std::uint64_t count : views) {
+        check(count > 0, "a reader never saw a published slot");
+        total += count;
+    }
+    std::printf("%llu concurrent snapshots checked\n", static_cast<unsigned long long>(total));
+}
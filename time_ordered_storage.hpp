@@ -0,0 +1,244 @@
+#ifndef TIME_ORDERED_STORAGE_HPP
+#define TIME_ORDERED_STORAGE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "offset_iterator.hpp"
+
+/**
+ * @brief A FIFO sequence of slots stored in fixed size segments.
+ *
+ * Slots are appended at the back and removed from the front, so when the slots are
+ * appended in time order the storage stays sorted by time without any extra work.
+ * Each slot is stored exactly once and never moves after construction, popping from
+ * the front is O(1), and random access by offset from the front is O(1) which makes
+ * binary searches over the stored timestamps possible.
+ *
+ * Every slot comes with a Stamp, typically its insertion time, which is not stored
+ * next to the slot but in a dense array of stamps of its own in every segment. Scans
+ * and searches over the stamps therefore only pull stamps through the cache, however
+ * large the slots are. Stamps have to be trivially copyable.
+ *
+ * Segments that become empty are kept around as spares so that a container hovering
+ * around a segment boundary does not allocate on every insert. reserve preallocates
+ * enough of them for a given number of slots, after which a storage that never holds
+ * more than that does not allocate at all, as long as no snapshot outlives the
+ * segments it references.
+ *
+ * Segments are reference counted so that a Snapshot can keep the slots it covers
+ * alive after the storage has moved on. The storage keeps an immutable table of its
+ * segments, replaced copy on write whenever a segment is added or removed, which
+ * every snapshot taken in the meantime shares. Slots are only ever appended past the
+ * end of an existing snapshot, and a slot popped from a segment that a snapshot still
+ * references is destroyed together with the segment instead of immediately, so a
+ * snapshot can be traversed without any synchronization with the storage.
+ *
+ * With ConcurrentReaders the storage also publishes that table atomically, together
+ * with the positions of its first and last slot, which published_snapshot() combines
+ * into a snapshot without any locking, from any thread, while the owner keeps
+ * appending and popping. The owner pays one atomic store per append and one fence per
+ * pop for this.
+ *
+ * Segments, the segment ring and the segment tables all allocate through Allocator,
+ * rebound as needed.
+ */
+template <typename Slot, typename Stamp, typename Allocator = std::allocator<Slot>, bool ConcurrentReaders = false>
+class TimeOrderedStorage {
+  private:
+    struct Segment;
+    struct SegmentTable;
+
+    template <typename U> using Rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+  public:
+    static constexpr std::size_t segment_capacity = 256;
+
+    /**
+     * @brief An immutable, time ordered view of the slots that were stored when it was taken.
+     *
+     * Taking a snapshot costs a single reference count increment, the slots themselves
+     * are not copied. Holding a snapshot delays the destruction of the slots it covers,
+     * so it should not be kept for longer than needed.
+     */
+    class Snapshot {
+      public:
+        using const_iterator = OffsetIterator<Snapshot, Slot>;
+
+        Snapshot() = default;
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, count); }
+
+        const Slot &operator[](std::size_t offset) const;
+        const Slot &front() const { return (*this)[0]; }
+        const Slot &back() const { return (*this)[count - 1]; }
+
+        const Stamp &stamp(std::size_t offset) const;
+        // the stamps from offset on that are contiguous in memory, up to the end of its segment or of the view
+        std::span<const Stamp> stamp_run(std::size_t offset) const;
+        // the same for the slots
+        std::span<const Slot> slot_run(std::size_t offset) const;
+
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        // drops the n oldest slots from the view
+        void remove_prefix(std::size_t n) {
+            head += n;
+            count -= n;
+        }
+
+      private:
+        friend class TimeOrderedStorage;
+
+        std::shared_ptr<const SegmentTable> table;
+        std::size_t head = 0; // offset of the front slot from the start of the table's first segment
+        std::size_t count = 0;
+    };
+
+    explicit TimeOrderedStorage(const Allocator &allocator = Allocator());
+    ~TimeOrderedStorage();
+
+    TimeOrderedStorage(const TimeOrderedStorage &) = delete;
+    TimeOrderedStorage &operator=(const TimeOrderedStorage &) = delete;
+
+    template <typename... Args> Slot &emplace_back(const Stamp &stamp, Args &&...args);
+    void pop_front();
+    void clear();
+
+    // allocates up front the segments needed to append n more slots
+    void reserve_back(std::size_t n);
+
+    // preallocates and keeps enough segments to hold n slots without allocating
+    void reserve(std::size_t n);
+
+    /**
+     * @brief Pops the n oldest slots, handing each one to sink together with its stamp before it is destroyed.
+     *
+     * sink(stamp, slot) receives the slot as an rvalue it may move from, unless a snapshot
+     * still references the slot, in which case it receives a const lvalue and has to copy.
+     */
+    template <typename Sink> void pop_front_into(std::size_t n, Sink &&sink);
+    // pop_front_into(size(), sink), with a single fence and a single table refresh instead of one per slot and segment
+    template <typename Sink> void pop_all_into(Sink &&sink);
+
+    /**
+     * @brief Hands every slot over to into, a newly constructed storage, in O(1) and leaves this one empty.
+     *
+     * into takes the segments and the segment table along with the slots, so snapshots
+     * taken before still see the slots they cover, and into defers destroying those
+     * slots like this storage would have. Readers of this storage see it empty from then
+     * on. Both storages must have equal allocators.
+     */
+    void move_all_into(TimeOrderedStorage &into);
+
+    Slot &front() { return (*this)[0]; }
+    const Slot &front() const { return (*this)[0]; }
+    Slot &back() { return (*this)[count - 1]; }
+    const Slot &back() const { return (*this)[count - 1]; }
+
+    // offset is relative to the front, so 0 is the oldest slot
+    Slot &operator[](std::size_t offset);
+    const Slot &operator[](std::size_t offset) const;
+    const Stamp &stamp(std::size_t offset) const;
+    std::span<const Stamp> stamp_run(std::size_t offset) const;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Takes a snapshot without synchronizing with the owner, only available with ConcurrentReaders.
+     *
+     * The snapshot holds every slot that was stored at some point during the call.
+     */
+    Snapshot published_snapshot() const;
+
+    // the number of slots as of the last append or pop, readable from any thread with ConcurrentReaders
+    std::size_t published_size() const;
+
+  private:
+    static_assert((segment_capacity & (segment_capacity - 1)) == 0, "segment_capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<Stamp>, "stamps are kept in raw storage and never destroyed");
+
+    struct Segment {
+        alignas(Slot) std::byte storage[segment_capacity * sizeof(Slot)];
+        alignas(Stamp) std::byte stamp_storage[segment_capacity * sizeof(Stamp)];
+        // slots in [constructed_begin, constructed_end) are alive and destroyed with the segment
+        std::size_t constructed_begin = 0;
+        std::size_t constructed_end = 0;
+
+        ~Segment() { destroy_until(constructed_end); }
+
+        Slot *slot(std::size_t index) { return std::launder(reinterpret_cast<Slot *>(storage) + index); }
+        const Slot *slot(std::size_t index) const {
+            return std::launder(reinterpret_cast<const Slot *>(storage) + index);
+        }
+        Stamp *stamp(std::size_t index) { return std::launder(reinterpret_cast<Stamp *>(stamp_storage) + index); }
+        const Stamp *stamp(std::size_t index) const {
+            return std::launder(reinterpret_cast<const Stamp *>(stamp_storage) + index);
+        }
+
+        void destroy_until(std::size_t index);
+    };
+
+    // the segments from the front of the ring, base is the position of the first slot of the first one
+    struct SegmentTable {
+        std::vector<std::shared_ptr<const Segment>, Rebind<std::shared_ptr<const Segment>>> segments;
+        std::uint64_t base = 0;
+
+        explicit SegmentTable(const Allocator &allocator) : segments(allocator) {}
+    };
+
+    // whether anyone besides the owners holds pointer
+    template <typename Pointer> static bool is_pinned(const Pointer &pointer, long owners);
+    bool is_shared(const std::shared_ptr<Segment> &segment) const;
+    bool advance_front();
+    void finish_pop(bool shared);
+    void refresh_table();
+
+    std::shared_ptr<Segment> &segment(std::size_t index) {
+        return segments[(first_segment + index) & (segments.size() - 1)];
+    }
+    const std::shared_ptr<Segment> &segment(std::size_t index) const {
+        return segments[(first_segment + index) & (segments.size() - 1)];
+    }
+
+    void push_segments(std::size_t n); // refreshes the table once for all of them
+    void pop_segment();
+    void grow_segments(std::size_t n);
+
+    // a ring of segment_count segments starting at first_segment, its size is a power of two
+    using SegmentVector = std::vector<std::shared_ptr<Segment>, Rebind<std::shared_ptr<Segment>>>;
+
+    Allocator allocator;
+    SegmentVector segments;
+    std::size_t first_segment = 0;
+    std::size_t segment_count = 0;
+    SegmentVector spares;
+    std::size_t spare_limit = 1;
+    std::size_t head = 0; // index of the front slot inside the first segment
+    std::size_t count = 0;
+    std::uint64_t base = 0; // position of the first slot of the front segment, counted since construction
+
+    std::shared_ptr<SegmentTable> table;       // the segments of the ring, shared by every snapshot taken since
+    std::shared_ptr<SegmentTable> spare_table; // a retired table nobody held on to, kept for reuse
+
+    // only used with ConcurrentReaders
+    std::atomic<std::shared_ptr<const SegmentTable>> published_table;
+    std::atomic<std::uint64_t> published_begin{0};
+    std::atomic<std::uint64_t> published_end{0};
+};
+
+#include "time_ordered_storage.tpp"
+
+#endif // TIME_ORDERED_STORAGE_HPP
@@ -0,0 +1,382 @@
+#include "time_ordered_storage.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::Segment::destroy_until(std::size_t index) {
+    for (; constructed_begin < index; ++constructed_begin) {
+        slot(constructed_begin)->~Slot();
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::TimeOrderedStorage(const Allocator &allocator)
+    : allocator(allocator), segments(allocator), spares(allocator) {
+    refresh_table();
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::~TimeOrderedStorage() {
+    clear();
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+template <typename... Args>
+Slot &TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::emplace_back(const Stamp &stamp, Args &&...args) {
+    std::size_t position = head + count;
+    std::size_t segment_index = position / segment_capacity;
+    if (segment_index == segment_count) {
+        push_segments(1);
+    }
+    Segment &target = *segment(segment_index);
+    std::size_t index = position % segment_capacity;
+    Slot *slot = target.slot(index);
+    ::new (static_cast<void *>(slot)) Slot(std::forward<Args>(args)...);
+    ::new (static_cast<void *>(target.stamp(index))) Stamp(stamp);
+    target.constructed_end = index + 1;
+    ++count;
+    if constexpr (ConcurrentReaders) {
+        // makes the constructed slot visible to readers
+        published_end.store(base + head + count, std::memory_order_release);
+    }
+    return *slot;
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::reserve_back(std::size_t n) {
+    std::size_t needed_segments = (head + count + n + segment_capacity - 1) / segment_capacity;
+    if (segment_count < needed_segments) {
+        push_segments(needed_segments - segment_count);
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::reserve(std::size_t n) {
+    // n slots starting anywhere inside a segment can reach into one more segment
+    std::size_t needed_segments = (n + segment_capacity - 1) / segment_capacity + 1;
+    grow_segments(needed_segments);
+    spare_limit = std::max(spare_limit, needed_segments);
+    spares.reserve(spare_limit);
+    while (segment_count + spares.size() < needed_segments) {
+        spares.push_back(std::allocate_shared_for_overwrite<Segment>(Rebind<Segment>(allocator)));
+    }
+    // the two tables take turns, so refreshing never has to grow either of them
+    if (!spare_table) {
+        spare_table = std::allocate_shared<SegmentTable>(Rebind<SegmentTable>(allocator), allocator);
+    }
+    spare_table->segments.reserve(needed_segments);
+    refresh_table();
+    if (spare_table) {
+        spare_table->segments.reserve(needed_segments);
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::pop_front() {
+    finish_pop(advance_front());
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+template <typename Sink>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::pop_front_into(std::size_t n, Sink &&sink) {
+    for (; n > 0; --n) {
+        Slot &slot = front();
+        const Stamp &front_stamp = stamp(0);
+        // readers can no longer reach the slot once it has been found unshared, so it can be moved from
+        bool shared = advance_front();
+        if (shared) {
+            sink(front_stamp, std::as_const(slot));
+        } else {
+            sink(front_stamp, std::move(slot));
+        }
+        finish_pop(shared);
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+template <typename Sink>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::pop_all_into(Sink &&sink) {
+    if constexpr (ConcurrentReaders) {
+        published_begin.store(base + head + count, std::memory_order_relaxed);
+        // as in advance_front, but for every slot at once: a reader pinning the table from now on sees none of them
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    try {
+        while (count > 0) {
+            Segment &front_segment = *segment(0);
+            bool shared = is_shared(segment(0));
+            std::size_t last = std::min(segment_capacity, head + count);
+            for (; head < last; ++head, --count) {
+                if (shared) {
+                    sink(*front_segment.stamp(head), std::as_const(*front_segment.slot(head)));
+                } else {
+                    sink(*front_segment.stamp(head), std::move(*front_segment.slot(head)));
+                    front_segment.destroy_until(head + 1);
+                }
+            }
+            if (head < segment_capacity) {
+                break;
+            }
+            if (!shared && spares.size() < spare_limit) {
+                front_segment.constructed_begin = 0;
+                front_segment.constructed_end = 0;
+                spares.push_back(std::move(segment(0)));
+            }
+            segment(0).reset();
+            first_segment = (first_segment + 1) & (segments.size() - 1);
+            --segment_count;
+            base += segment_capacity;
+            head = 0;
+        }
+    } catch (...) {
+        // the slots popped so far stay popped, the table has to drop their segments all the same
+        refresh_table();
+        throw;
+    }
+    refresh_table();
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+bool TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::advance_front() {
+    ++head;
+    --count;
+    if constexpr (ConcurrentReaders) {
+        published_begin.store(base + head, std::memory_order_relaxed);
+        // either a reader pinning the table from now on sees the new begin, or is_shared sees its pin
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    return is_shared(segment(0));
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::finish_pop(bool shared) {
+    std::shared_ptr<Segment> &front_segment = segment(0);
+    if (!shared) {
+        front_segment->destroy_until(head);
+    }
+    if (head == segment_capacity) {
+        if (!shared && spares.size() < spare_limit) {
+            front_segment->constructed_begin = 0;
+            front_segment->constructed_end = 0;
+            spares.push_back(std::move(front_segment));
+        }
+        pop_segment();
+        head = 0;
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::move_all_into(TimeOrderedStorage &into) {
+    std::uint64_t end = base + head + count;
+    std::swap(segments, into.segments);
+    std::swap(first_segment, into.first_segment);
+    std::swap(segment_count, into.segment_count);
+    std::swap(head, into.head);
+    std::swap(count, into.count);
+    std::swap(base, into.base);
+    std::swap(table, into.table);
+    if constexpr (ConcurrentReaders) {
+        // readers may have pinned the table through us, into counts its published copy as one of its owners
+        into.published_table.store(into.table, std::memory_order_relaxed);
+        into.published_begin.store(into.base + into.head, std::memory_order_relaxed);
+        into.published_end.store(end, std::memory_order_relaxed);
+    }
+    // restart at a segment boundary past every slot of the old table, so that a reader still holding it clamps its
+    // view to nothing however far published_end moves on
+    base = (end + segment_capacity - 1) / segment_capacity * segment_capacity;
+    head = 0;
+    refresh_table();
+    if constexpr (ConcurrentReaders) {
+        published_begin.store(base, std::memory_order_relaxed);
+        published_end.store(base, std::memory_order_release);
+        // pairs with the fence in published_snapshot, like the one in advance_front
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::clear() {
+    while (count > 0) {
+        pop_front();
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+Slot &TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::operator[](std::size_t offset) {
+    std::size_t position = head + offset;
+    return *segment(position / segment_capacity)->slot(position % segment_capacity);
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+const Slot &TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::operator[](std::size_t offset) const {
+    std::size_t position = head + offset;
+    return *segment(position / segment_capacity)->slot(position % segment_capacity);
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+const Stamp &TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::stamp(std::size_t offset) const {
+    std::size_t position = head + offset;
+    return *segment(position / segment_capacity)->stamp(position % segment_capacity);
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+std::span<const Stamp> TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::stamp_run(
+    std::size_t offset) const {
+    std::size_t position = head + offset;
+    std::size_t index = position % segment_capacity;
+    return {segment(position / segment_capacity)->stamp(index), std::min(segment_capacity - index, count - offset)};
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+typename TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::Snapshot
+TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::snapshot() const {
+    Snapshot snapshot;
+    snapshot.table = table;
+    snapshot.head = head;
+    snapshot.count = count;
+    return snapshot;
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+typename TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::Snapshot
+TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::published_snapshot() const {
+    static_assert(ConcurrentReaders, "only a storage with ConcurrentReaders publishes its segments");
+    Snapshot snapshot;
+    snapshot.table = published_table.load(std::memory_order_acquire);
+    // pairs with the fence in advance_front
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // end first: the begin loaded after it is at least as new as the pushes it covers, so an end pushed after
+    // move_all_into comes with a begin past every slot of the tables before it
+    std::uint64_t last = published_end.load(std::memory_order_acquire);
+    std::uint64_t first = published_begin.load(std::memory_order_relaxed);
+    // the table may be older than the positions, and only covers its own segments
+    const SegmentTable &pinned = *snapshot.table;
+    std::uint64_t limit = pinned.base + pinned.segments.size() * segment_capacity;
+    first = std::clamp(first, pinned.base, limit);
+    last = std::clamp(last, first, limit);
+    snapshot.head = static_cast<std::size_t>(first - pinned.base);
+    snapshot.count = static_cast<std::size_t>(last - first);
+    return snapshot;
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+std::size_t TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::published_size() const {
+    static_assert(ConcurrentReaders, "only a storage with ConcurrentReaders publishes its size");
+    // load begin first, end can only move further away from it in the meantime
+    std::uint64_t first = published_begin.load(std::memory_order_relaxed);
+    return static_cast<std::size_t>(published_end.load(std::memory_order_relaxed) - first);
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::push_segments(std::size_t n) {
+    grow_segments(segment_count + n);
+    for (; n > 0; --n) {
+        std::shared_ptr<Segment> &next = segment(segment_count);
+        if (spares.empty()) {
+            next = std::allocate_shared_for_overwrite<Segment>(Rebind<Segment>(allocator));
+        } else {
+            next = std::move(spares.back());
+            spares.pop_back();
+        }
+        ++segment_count;
+    }
+    refresh_table();
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::pop_segment() {
+    segment(0).reset();
+    first_segment = (first_segment + 1) & (segments.size() - 1);
+    --segment_count;
+    base += segment_capacity;
+    refresh_table();
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::grow_segments(std::size_t n) {
+    if (n <= segments.size()) {
+        return;
+    }
+    std::size_t size = std::max<std::size_t>(segments.size(), 4);
+    while (size < n) {
+        size *= 2;
+    }
+    SegmentVector grown(size, allocator);
+    for (std::size_t index = 0; index < segment_count; ++index) {
+        grown[index] = std::move(segment(index));
+    }
+    segments = std::move(grown);
+    first_segment = 0;
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+void TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::refresh_table() {
+    std::shared_ptr<SegmentTable> next = std::move(spare_table);
+    if (!next) {
+        next = std::allocate_shared<SegmentTable>(Rebind<SegmentTable>(allocator), allocator);
+    }
+    next->segments.reserve(segment_count);
+    for (std::size_t index = 0; index < segment_count; ++index) {
+        next->segments.push_back(segment(index));
+    }
+    next->base = base;
+    if constexpr (ConcurrentReaders) {
+        published_table.store(next, std::memory_order_release);
+    }
+    std::shared_ptr<SegmentTable> retired = std::exchange(table, std::move(next));
+    if (retired && !is_pinned(retired, 1)) {
+        // a retired table would keep its segments looking shared while it waits to be reused
+        retired->segments.clear();
+        spare_table = std::move(retired);
+    }
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+template <typename Pointer>
+bool TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::is_pinned(const Pointer &pointer, long owners) {
+    if (pointer.use_count() > owners) {
+        return true;
+    }
+    // pairs with the release of the last reader's reference so its reads happen before we touch the slots
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return false;
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+bool TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::is_shared(
+    const std::shared_ptr<Segment> &segment) const {
+    // the ring and the current table hold every segment, the current table is held by us and published_table
+    return is_pinned(table, ConcurrentReaders ? 2 : 1) || is_pinned(segment, 2);
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+const Slot &TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::Snapshot::operator[](
+    std::size_t offset) const {
+    std::size_t position = head + offset;
+    return *table->segments[position / segment_capacity]->slot(position % segment_capacity);
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+const Stamp &TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::Snapshot::stamp(std::size_t offset) const {
+    std::size_t position = head + offset;
+    return *table->segments[position / segment_capacity]->stamp(position % segment_capacity);
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+std::span<const Stamp> TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::Snapshot::stamp_run(
+    std::size_t offset) const {
+    std::size_t position = head + offset;
+    std::size_t index = position % segment_capacity;
+    return {table->segments[position / segment_capacity]->stamp(index),
+            std::min(segment_capacity - index, count - offset)};
+}
+
+template <typename Slot, typename Stamp, typename Allocator, bool ConcurrentReaders>
+std::span<const Slot> TimeOrderedStorage<Slot, Stamp, Allocator, ConcurrentReaders>::Snapshot::slot_run(
+    std::size_t offset) const {
+    std::size_t position = head + offset;
+    std::size_t index = position % segment_capacity;
+    return {table->segments[position / segment_capacity]->slot(index),
+            std::min(segment_capacity - index, count - offset)};
+}
@@ -0,0 +1,94 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief A hierarchical timer wheel over integer ticks.
+ *
+ * Values are scheduled at a deadline tick and handed back once the wheel has been
+ * advanced past that tick. Level 0 has one slot per tick, every further level has
+ * slots that are slots_per_level times coarser, and the entries of a coarse slot are
+ * cascaded down to the finer levels once the wheel reaches that slot. Scheduling is
+ * O(1) and every entry is moved at most once per level before it fires, so the wheel
+ * stays O(1) amortized per timer no matter how many timers are pending. Deadlines
+ * further away than the top level can represent are parked in an overflow list and
+ * picked up again whenever the top level turns.
+ *
+ * There is no cancellation, callers that need it tag their values and ignore the stale
+ * ones when they fire.
+ *
+ * Slots are vectors allocated through Allocator. Draining a slot swaps it with a spare
+ * buffer instead of releasing it, so a wheel that has warmed up keeps reusing the same
+ * buffers.
+ */
+template <typename Value, typename Allocator = std::allocator<Value>> class TimerWheel {
+  public:
+    static constexpr std::size_t bits_per_level = 6;
+    static constexpr std::size_t slots_per_level = std::size_t{1} << bits_per_level;
+    static constexpr std::size_t levels = 4;
+
+    explicit TimerWheel(std::uint64_t start_tick = 0, const Allocator &allocator = Allocator());
+
+    /**
+     * @brief Schedules value to fire once the wheel is advanced to deadline_tick.
+     *
+     * A deadline that has already passed fires on the next advance.
+     */
+    void schedule(std::uint64_t deadline_tick, Value value);
+
+    /**
+     * @brief Processes every tick up to and including now_tick, calling on_fire(deadline_tick, value)
+     * for every value whose deadline has been reached.
+     */
+    template <typename OnFire> void advance(std::uint64_t now_tick, OnFire &&on_fire);
+
+    /**
+     * @brief Returns the earliest tick at which advance could fire or cascade something.
+     *
+     * For entries on the coarser levels this is when they get cascaded, which is never
+     * later than their deadline, so sleeping until this tick and advancing cannot miss a
+     * deadline.
+     */
+    std::optional<std::uint64_t> next_tick() const;
+
+    std::size_t size() const { return pending; }
+    bool empty() const { return pending == 0; }
+
+    // the next tick that advance will process
+    std::uint64_t current_tick() const { return current; }
+
+  private:
+    struct Entry {
+        std::uint64_t deadline_tick;
+        Value value;
+    };
+
+    using Slot = std::vector<Entry, typename std::allocator_traits<Allocator>::template rebind_alloc<Entry>>;
+
+    static constexpr std::uint64_t level_span(std::size_t level) {
+        return std::uint64_t{1} << (bits_per_level * level);
+    }
+    static constexpr std::size_t slot_index(std::uint64_t tick, std::size_t level) {
+        return (tick >> (bits_per_level * level)) & (slots_per_level - 1);
+    }
+
+    void place(Entry entry);
+    void cascade(std::size_t level);
+    void take(Slot &slot);
+
+    std::array<std::array<Slot, slots_per_level>, levels> wheel;
+    Slot overflow;
+    Slot drained; // the entries being processed, its previous buffer now belongs to the slot they came from
+    std::uint64_t current;
+    std::size_t pending = 0;
+};
+
+#include "timer_wheel.tpp"
+
+#endif // TIMER_WHEEL_HPP
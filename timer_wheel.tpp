@@ -0,0 +1,113 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <utility>
+
+template <typename Value, typename Allocator>
+TimerWheel<Value, Allocator>::TimerWheel(std::uint64_t start_tick, const Allocator &allocator)
+    : overflow(allocator), drained(allocator), current(start_tick) {
+    for (auto &level : wheel) {
+        for (Slot &slot : level) {
+            slot = Slot(allocator);
+        }
+    }
+}
+
+template <typename Value, typename Allocator>
+void TimerWheel<Value, Allocator>::schedule(std::uint64_t deadline_tick, Value value) {
+    place(Entry{deadline_tick, std::move(value)});
+    ++pending;
+}
+
+template <typename Value, typename Allocator>
+template <typename OnFire>
+void TimerWheel<Value, Allocator>::advance(std::uint64_t now_tick, OnFire &&on_fire) {
+    while (current <= now_tick) {
+        // nothing happens on the ticks in between, so skip straight to the next one that matters
+        std::optional<std::uint64_t> next = next_tick();
+        if (!next || *next > now_tick) {
+            current = now_tick + 1;
+            return;
+        }
+        std::uint64_t tick = std::max(current, *next);
+
+        if (!overflow.empty() && tick % level_span(levels - 1) == 0) {
+            take(overflow);
+            current = tick;
+            for (Entry &entry : drained) {
+                place(std::move(entry));
+            }
+            drained.clear();
+        }
+        for (std::size_t level = levels - 1; level > 0; --level) {
+            if (tick % level_span(level) == 0) {
+                current = tick;
+                cascade(level);
+            }
+        }
+
+        take(wheel[0][slot_index(tick, 0)]);
+        // anything scheduled by on_fire lands on a later tick instead of the slot being drained
+        current = tick + 1;
+        pending -= drained.size();
+        for (Entry &entry : drained) {
+            on_fire(entry.deadline_tick, std::move(entry.value));
+        }
+        drained.clear();
+    }
+}
+
+template <typename Value, typename Allocator>
+std::optional<std::uint64_t> TimerWheel<Value, Allocator>::next_tick() const {
+    std::optional<std::uint64_t> earliest;
+    for (std::size_t level = 0; level < levels; ++level) {
+        // the first block of this level that starts at or after current
+        std::uint64_t first_block = (current + level_span(level) - 1) >> (bits_per_level * level);
+        for (std::size_t offset = 0; offset < slots_per_level; ++offset) {
+            std::uint64_t block = first_block + offset;
+            if (!wheel[level][block & (slots_per_level - 1)].empty()) {
+                std::uint64_t tick = block << (bits_per_level * level);
+                if (!earliest || tick < *earliest) {
+                    earliest = tick;
+                }
+                break;
+            }
+        }
+    }
+    if (!overflow.empty()) {
+        std::uint64_t span = level_span(levels - 1);
+        std::uint64_t tick = (current + span - 1) / span * span;
+        if (!earliest || tick < *earliest) {
+            earliest = tick;
+        }
+    }
+    return earliest;
+}
+
+template <typename Value, typename Allocator>
+void TimerWheel<Value, Allocator>::place(Entry entry) {
+    std::uint64_t effective = std::max(entry.deadline_tick, current);
+    std::uint64_t delta = effective - current;
+    for (std::size_t level = 0; level < levels; ++level) {
+        if (delta < level_span(level + 1)) {
+            wheel[level][slot_index(effective, level)].push_back(std::move(entry));
+            return;
+        }
+    }
+    overflow.push_back(std::move(entry));
+}
+
+template <typename Value, typename Allocator>
+void TimerWheel<Value, Allocator>::cascade(std::size_t level) {
+    take(wheel[level][slot_index(current, level)]);
+    for (Entry &entry : drained) {
+        place(std::move(entry));
+    }
+    drained.clear();
+}
+
+template <typename Value, typename Allocator>
+void TimerWheel<Value, Allocator>::take(Slot &slot) {
+    // drained is always empty here, so the slot keeps its capacity for the next entries
+    drained.swap(slot);
+}
@@ -0,0 +1,98 @@
+#include "timestamp_scan.hpp"
+
+#include <bit>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// compares vector_words consecutive words with limit, bit i of the result is set when word i is greater
+#if defined(__AVX512F__)
+constexpr std::size_t vector_words = 8;
+
+unsigned greater_words(const std::int64_t *words, std::int64_t limit) {
+    return _mm512_cmpgt_epi64_mask(_mm512_loadu_si512(words), _mm512_set1_epi64(limit));
+}
+#elif defined(__AVX2__)
+constexpr std::size_t vector_words = 4;
+
+unsigned greater_words(const std::int64_t *words, std::int64_t limit) {
+    __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words));
+    __m256i greater = _mm256_cmpgt_epi64(values, _mm256_set1_epi64x(limit));
+    return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(greater)));
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+constexpr std::size_t vector_words = 4;
+
+unsigned greater_words(const std::int64_t *words, std::int64_t limit) {
+    int64x2_t bound = vdupq_n_s64(limit);
+    uint64x2_t low = vcgtq_s64(vld1q_s64(words), bound);
+    uint64x2_t high = vcgtq_s64(vld1q_s64(words + 2), bound);
+    return static_cast<unsigned>((vgetq_lane_u64(low, 0) & 1) | (vgetq_lane_u64(low, 1) & 2) |
+                                 (vgetq_lane_u64(high, 0) & 4) | (vgetq_lane_u64(high, 1) & 8));
+}
+#else
+constexpr std::size_t vector_words = 0;
+
+unsigned greater_words(const std::int64_t *, std::int64_t) { return 0; }
+#endif
+
+// a vector only lines up with whole records when the stride divides its width
+bool vectorizes(std::size_t stride) { return vector_words > 0 && stride <= 2; }
+
+// the bits of greater_words belonging to the compared field of every record
+unsigned field_lanes(std::size_t stride, std::size_t field) {
+    unsigned lanes = 0;
+    for (std::size_t word = field; word < vector_words; word += stride) {
+        lanes |= 1u << word;
+    }
+    return lanes;
+}
+
+} // namespace
+
+namespace timestamp_scan {
+
+std::size_t find_first_greater(const std::int64_t *records, std::size_t n, std::size_t stride, std::size_t field,
+                               std::int64_t limit) {
+    std::size_t index = 0;
+    if (vectorizes(stride)) {
+        std::size_t per_vector = vector_words / stride;
+        unsigned lanes = field_lanes(stride, field);
+        for (; index + per_vector <= n; index += per_vector) {
+            unsigned greater = greater_words(records + index * stride, limit) & lanes;
+            if (greater != 0) {
+                return index + static_cast<std::size_t>(std::countr_zero(greater)) / stride;
+            }
+        }
+    }
+    for (; index < n; ++index) {
+        if (records[index * stride + field] > limit) {
+            return index;
+        }
+    }
+    return n;
+}
+
+std::size_t count_greater(const std::int64_t *records, std::size_t n, std::size_t stride, std::size_t field,
+                          std::int64_t limit) {
+    std::size_t count = 0;
+    std::size_t index = 0;
+    if (vectorizes(stride)) {
+        std::size_t per_vector = vector_words / stride;
+        unsigned lanes = field_lanes(stride, field);
+        for (; index + per_vector <= n; index += per_vector) {
+            count += static_cast<std::size_t>(std::popcount(greater_words(records + index * stride, limit) & lanes));
+        }
+    }
+    for (; index < n; ++index) {
+        count += records[index * stride + field] > limit;
+    }
+    return count;
+}
+
+} // namespace timestamp_scan
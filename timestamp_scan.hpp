@@ -0,0 +1,34 @@
+#ifndef TIMESTAMP_SCAN_HPP
+#define TIMESTAMP_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Vectorized scans over densely packed timestamps, given as their 64 bit tick counts.
+ *
+ * The timestamps are read from n records of stride 64 bit words each, field being the
+ * word of every record that is compared, so that records holding both an insertion and
+ * an expiration time can be scanned for either one without copying them apart. Every
+ * word of every record is loaded, never anything past the last record.
+ *
+ * The kernels use AVX-512 or AVX2 on x86 and NEON on AArch64, whichever the translation
+ * unit is compiled for, and fall back to a scalar loop otherwise and for strides above 2.
+ */
+namespace timestamp_scan {
+
+/**
+ * @brief Returns the index of the first record whose timestamp is greater than limit, n if there is none.
+ */
+std::size_t find_first_greater(const std::int64_t *records, std::size_t n, std::size_t stride, std::size_t field,
+                               std::int64_t limit);
+
+/**
+ * @brief Returns how many of the records have a timestamp greater than limit.
+ */
+std::size_t count_greater(const std::int64_t *records, std::size_t n, std::size_t stride, std::size_t field,
+                          std::int64_t limit);
+
+} // namespace timestamp_scan
+
+#endif // TIMESTAMP_SCAN_HPP
@@ -0,0 +1,188 @@
+#ifndef WINDOW_AGGREGATES_HPP
+#define WINDOW_AGGREGATES_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * An aggregate summarizes the elements of a container's window incrementally:
+ *   on_insert(value)  called for every element appended at the back
+ *   on_remove(value)  called for every element removed from the front, in insertion order
+ * Reading an aggregate never touches the elements themselves. Projection turns an element
+ * into the number being aggregated, by default the element itself.
+ */
+
+/**
+ * @brief The aggregates of a container that keeps none.
+ */
+struct NoAggregates {
+    template <typename T> void on_insert(const T &) {}
+    template <typename T> void on_remove(const T &) {}
+};
+
+/**
+ * @brief Combines several aggregates into one, get<Aggregate>() returns each of them.
+ */
+template <typename... Aggregates> class WindowAggregates {
+  public:
+    template <typename T> void on_insert(const T &value) { (std::get<Aggregates>(parts).on_insert(value), ...); }
+    template <typename T> void on_remove(const T &value) { (std::get<Aggregates>(parts).on_remove(value), ...); }
+
+    template <typename Aggregate> const Aggregate &get() const { return std::get<Aggregate>(parts); }
+
+  private:
+    std::tuple<Aggregates...> parts;
+};
+
+/**
+ * @brief The number of elements in the window.
+ */
+class CountAggregate {
+  public:
+    template <typename T> void on_insert(const T &) { ++elements; }
+    template <typename T> void on_remove(const T &) { --elements; }
+
+    std::size_t count() const { return elements; }
+
+  private:
+    std::size_t elements = 0;
+};
+
+/**
+ * @brief The sum and mean of the window.
+ *
+ * The sum is kept as a Value, so integral sums are exact while floating point sums
+ * accumulate rounding errors over many inserts and removals.
+ */
+template <typename Projection = std::identity, typename Value = double> class SumAggregate {
+  public:
+    template <typename T> void on_insert(const T &value) {
+        total += static_cast<Value>(std::invoke(Projection{}, value));
+        ++elements;
+    }
+    template <typename T> void on_remove(const T &value) {
+        total -= static_cast<Value>(std::invoke(Projection{}, value));
+        --elements;
+    }
+
+    Value sum() const { return total; }
+    // 0 for an empty window
+    double mean() const { return elements == 0 ? 0.0 : static_cast<double>(total) / static_cast<double>(elements); }
+
+  private:
+    Value total{};
+    std::size_t elements = 0;
+};
+
+/**
+ * @brief The minimum and maximum of the window, kept in two monotonic deques.
+ *
+ * Each deque holds the elements that can still become the extreme once everything
+ * older than them has been removed, so inserts and removals are O(1) amortized and
+ * reading either extreme is O(1).
+ */
+template <typename Projection = std::identity, typename Value = double> class MinMaxAggregate {
+  public:
+    template <typename T> void on_insert(const T &value);
+    template <typename T> void on_remove(const T &value);
+
+    // both require a non-empty window
+    Value min() const { return minima.front().second; }
+    Value max() const { return maxima.front().second; }
+    bool empty() const { return inserted == removed; }
+
+  private:
+    using Candidate = std::pair<std::uint64_t, Value>; // insertion sequence number and value
+
+    std::deque<Candidate> minima; // increasing values, the front is the minimum
+    std::deque<Candidate> maxima; // decreasing values, the front is the maximum
+    std::uint64_t inserted = 0;
+    std::uint64_t removed = 0;
+};
+
+/**
+ * @brief Approximate quantiles of the window with a bounded relative error.
+ *
+ * Values are counted in logarithmic buckets whose bounds grow by a factor of
+ * (1 + accuracy) / (1 - accuracy), so any quantile is answered with a value within
+ * relative_accuracy of the true one. Bucket counts can go down as easily as up, which
+ * is what makes removal possible. Magnitudes below min_magnitude count as zero and
+ * those above max_magnitude are clamped to it. NaN values are skipped: they count
+ * towards count() but are in no bucket, so quantiles are those of the other values.
+ * Reading a quantile costs one pass over the buckets, independent of the window size.
+ */
+template <typename Projection = std::identity> class QuantileAggregate {
+  public:
+    static constexpr double min_magnitude = 1e-9;
+    static constexpr double max_magnitude = 1e18;
+
+    /**
+     * @brief Throws std::invalid_argument unless relative_accuracy lies strictly between 0 and 1.
+     */
+    explicit QuantileAggregate(double relative_accuracy = 0.01);
+
+    template <typename T> void on_insert(const T &value) { add(project(value), 1); }
+    template <typename T> void on_remove(const T &value) { add(project(value), -1); }
+
+    /**
+     * @brief Returns the q quantile for q in [0, 1], 0 for a window without a value other than NaN.
+     */
+    double quantile(double q) const;
+
+    std::uint64_t count() const { return total; }
+
+  private:
+    template <typename T> static double project(const T &value) {
+        return static_cast<double>(std::invoke(Projection{}, value));
+    }
+    void add(double value, int delta);
+    std::size_t bucket_of(double magnitude) const;
+    double value_of(std::size_t bucket) const;
+
+    double gamma;
+    double log_gamma;
+    int min_key;
+    // both indexed by bucket_of the magnitude, negative values are walked in reverse
+    std::vector<std::uint64_t> negative;
+    std::vector<std::uint64_t> positive;
+    std::uint64_t zeros = 0;
+    std::uint64_t nans = 0;
+    std::uint64_t total = 0;
+};
+
+/**
+ * @brief Whether a key is in the window, answered in O(1), for deduplicating against the window.
+ *
+ * Counts the elements under every key, so a key stays in the window until the last of
+ * its elements is removed. Projection turns an element into its Key. This is the exact
+ * counterpart of ExpiringBloomFilter, at the cost of a hash map entry per distinct key.
+ */
+template <typename Key, typename Projection = std::identity, typename Hash = std::hash<Key>>
+class MembershipAggregate {
+  public:
+    template <typename T> void on_insert(const T &value) { ++counts[key_of(value)]; }
+    template <typename T> void on_remove(const T &value);
+
+    bool contains(const Key &key) const { return counts.find(key) != counts.end(); }
+    std::size_t distinct() const { return counts.size(); }
+
+  private:
+    template <typename T> static Key key_of(const T &value) {
+        return static_cast<Key>(std::invoke(Projection{}, value));
+    }
+
+    std::unordered_map<Key, std::size_t, Hash> counts; // never holds a zero count
+};
+
+#include "window_aggregates.tpp"
+
+#endif // WINDOW_AGGREGATES_HPP
@@ -0,0 +1,108 @@
+#include "window_aggregates.hpp"
+
+template <typename Projection, typename Value>
+template <typename T>
+void MinMaxAggregate<Projection, Value>::on_insert(const T &value) {
+    Value projected = static_cast<Value>(std::invoke(Projection{}, value));
+    // a candidate beaten by a newer value can never become the extreme again
+    while (!minima.empty() && !(minima.back().second < projected)) {
+        minima.pop_back();
+    }
+    while (!maxima.empty() && !(projected < maxima.back().second)) {
+        maxima.pop_back();
+    }
+    minima.emplace_back(inserted, projected);
+    maxima.emplace_back(inserted, projected);
+    ++inserted;
+}
+
+template <typename Projection, typename Value>
+template <typename T>
+void MinMaxAggregate<Projection, Value>::on_remove(const T &) {
+    // removals come in insertion order, so the removed element is a candidate only if it is at the front
+    if (!minima.empty() && minima.front().first == removed) {
+        minima.pop_front();
+    }
+    if (!maxima.empty() && maxima.front().first == removed) {
+        maxima.pop_front();
+    }
+    ++removed;
+}
+
+template <typename Projection>
+QuantileAggregate<Projection>::QuantileAggregate(double relative_accuracy) {
+    if (!(relative_accuracy > 0.0 && relative_accuracy < 1.0)) {
+        throw std::invalid_argument("QuantileAggregate accuracy must lie between 0 and 1");
+    }
+    gamma = (1.0 + relative_accuracy) / (1.0 - relative_accuracy);
+    log_gamma = std::log(gamma);
+    min_key = static_cast<int>(std::ceil(std::log(min_magnitude) / log_gamma));
+    int max_key = static_cast<int>(std::ceil(std::log(max_magnitude) / log_gamma));
+    negative.assign(static_cast<std::size_t>(max_key - min_key + 1), 0);
+    positive.assign(negative.size(), 0);
+}
+
+template <typename Projection>
+void QuantileAggregate<Projection>::add(double value, int delta) {
+    double magnitude = std::fabs(value);
+    if (std::isnan(value)) {
+        // NaN has no bucket, and would reach bucket_of through both comparisons below failing
+        nans += delta;
+    } else if (magnitude < min_magnitude) {
+        zeros += delta;
+    } else if (value > 0) {
+        positive[bucket_of(magnitude)] += delta;
+    } else {
+        negative[bucket_of(magnitude)] += delta;
+    }
+    total += delta;
+}
+
+template <typename Projection>
+std::size_t QuantileAggregate<Projection>::bucket_of(double magnitude) const {
+    // bucket k holds the magnitudes in (gamma^(k - 1), gamma^k], clamped as a double so no key can overflow an int
+    double key = std::ceil(std::log(std::min(magnitude, max_magnitude)) / log_gamma) - min_key;
+    return static_cast<std::size_t>(std::clamp(key, 0.0, static_cast<double>(positive.size() - 1)));
+}
+
+template <typename Projection>
+double QuantileAggregate<Projection>::value_of(std::size_t bucket) const {
+    // the point within relative accuracy of both bounds
+    return 2.0 * std::pow(gamma, static_cast<int>(bucket) + min_key) / (gamma + 1.0);
+}
+
+template <typename Projection>
+double QuantileAggregate<Projection>::quantile(double q) const {
+    std::uint64_t counted = total - nans;
+    if (counted == 0) {
+        return 0.0;
+    }
+    auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(counted - 1));
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = negative.size(); bucket > 0; --bucket) {
+        seen += negative[bucket - 1];
+        if (seen > rank) {
+            return -value_of(bucket - 1);
+        }
+    }
+    seen += zeros;
+    if (seen > rank) {
+        return 0.0;
+    }
+    for (std::size_t bucket = 0; bucket < positive.size(); ++bucket) {
+        seen += positive[bucket];
+        if (seen > rank) {
+            return value_of(bucket);
+        }
+    }
+    return value_of(positive.size() - 1);
+}
+
+template <typename Key, typename Projection, typename Hash>
+template <typename T>
+void MembershipAggregate<Key, Projection, Hash>::on_remove(const T &value) {
+    auto entry = counts.find(key_of(value));
+    if (--entry->second == 0) {
+        counts.erase(entry);
+    }
+}